@@ -0,0 +1,388 @@
+// Measures the DeviceManager's own overhead: device creation, the BeginFrame/Present round trip,
+// swap chain recreation and shutdown. Runs headless on Vulkan so it works without a window
+// (and on software implementations like lavapipe), and prints the results as JSON.
+// --null uses the null backend instead, which leaves only the CPU cost of the DeviceManager itself,
+// with --gpu-frame-time as the simulated GPU time per frame in milliseconds.
+//
+// Usage: ElegyRhiBench [--iterations N] [--frames N] [--warmup N] [--width W] [--height H]
+//                      [--vsync] [--validation] [--null] [--gpu-frame-time MS] [--output file.json]
+//                      [--trace file.json|file.pftrace]
+// --trace writes the timeline markers of the last iterations, as Chrome trace JSON if the file name ends
+// in .json and as a Perfetto trace otherwise. Needs a build with ELR_ENABLE_TRACE
+
+#include "elegy-rhi/DeviceManager.hpp"
+#include "elegy-rhi/Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	struct BenchOptions
+	{
+		// device lifecycle and resize scenarios
+		uint32_t iterations = 20;
+		// frame loop scenario
+		uint32_t frames = 1000;
+		uint32_t warmupFrames = 30;
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		bool vsync = false;
+		bool validation = false;
+		bool null = false;
+		double gpuFrameTimeMs = 0.0;
+		std::string outputPath;
+		std::string tracePath;
+	};
+
+	class BenchMessageCallback final : public nvrhi::IMessageCallback
+	{
+	public:
+		void message( nvrhi::MessageSeverity severity, const char* messageText ) override
+		{
+			// stdout may be carrying the JSON, and info messages would just be noise anyway
+			if ( severity >= nvrhi::MessageSeverity::Warning )
+			{
+				std::cerr << messageText << std::endl;
+			}
+		}
+	};
+
+	// Collects timings of one scenario, in milliseconds
+	class Distribution
+	{
+	public:
+		void Add( double milliseconds )
+		{
+			m_Samples.push_back( milliseconds );
+		}
+
+		void WriteJson( std::ostream& out ) const
+		{
+			std::vector<double> sorted = m_Samples;
+			std::sort( sorted.begin(), sorted.end() );
+
+			double mean = 0.0;
+			for ( double sample : sorted )
+				mean += sample;
+			mean = sorted.empty() ? 0.0 : mean / sorted.size();
+
+			double variance = 0.0;
+			for ( double sample : sorted )
+				variance += (sample - mean) * (sample - mean);
+			variance = sorted.size() < 2 ? 0.0 : variance / (sorted.size() - 1);
+
+			out << "{ \"samples\": " << sorted.size()
+				<< ", \"min\": " << (sorted.empty() ? 0.0 : sorted.front())
+				<< ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back())
+				<< ", \"mean\": " << mean
+				<< ", \"stddev\": " << std::sqrt( variance )
+				<< ", \"p50\": " << Percentile( sorted, 0.50 )
+				<< ", \"p95\": " << Percentile( sorted, 0.95 )
+				<< ", \"p99\": " << Percentile( sorted, 0.99 )
+				<< " }";
+		}
+
+	private:
+		// nearest rank, sorted must be sorted
+		static double Percentile( const std::vector<double>& sorted, double fraction )
+		{
+			if ( sorted.empty() )
+				return 0.0;
+
+			const size_t rank = size_t( std::ceil( fraction * sorted.size() ) );
+			return sorted[std::clamp<size_t>( rank, 1, sorted.size() ) - 1];
+		}
+
+		std::vector<double> m_Samples;
+	};
+
+	class Stopwatch
+	{
+	public:
+		Stopwatch()
+			: m_Start( std::chrono::steady_clock::now() )
+		{
+		}
+
+		[[nodiscard]] double ElapsedMilliseconds() const
+		{
+			return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_Start ).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point m_Start;
+	};
+
+	bool ParseArguments( int argc, char** argv, BenchOptions& options )
+	{
+		for ( int i = 1; i < argc; i++ )
+		{
+			const char* arg = argv[i];
+			const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+			auto readNumber = [&]( uint32_t& outValue )
+			{
+				if ( nullptr == value )
+				{
+					std::cerr << arg << " needs a value" << std::endl;
+					return false;
+				}
+
+				outValue = uint32_t( std::strtoul( value, nullptr, 10 ) );
+				i++;
+				return true;
+			};
+
+			bool ok = true;
+			if ( !std::strcmp( arg, "--iterations" ) )
+				ok = readNumber( options.iterations );
+			else if ( !std::strcmp( arg, "--frames" ) )
+				ok = readNumber( options.frames );
+			else if ( !std::strcmp( arg, "--warmup" ) )
+				ok = readNumber( options.warmupFrames );
+			else if ( !std::strcmp( arg, "--width" ) )
+				ok = readNumber( options.width );
+			else if ( !std::strcmp( arg, "--height" ) )
+				ok = readNumber( options.height );
+			else if ( !std::strcmp( arg, "--vsync" ) )
+				options.vsync = true;
+			else if ( !std::strcmp( arg, "--validation" ) )
+				options.validation = true;
+			else if ( !std::strcmp( arg, "--null" ) )
+				options.null = true;
+			else if ( !std::strcmp( arg, "--gpu-frame-time" ) && nullptr != value )
+				options.gpuFrameTimeMs = std::strtod( argv[++i], nullptr );
+			else if ( !std::strcmp( arg, "--output" ) && nullptr != value )
+				options.outputPath = argv[++i];
+			else if ( !std::strcmp( arg, "--trace" ) && nullptr != value )
+				options.tracePath = argv[++i];
+			else
+			{
+				std::cerr << "Unknown argument: " << arg << std::endl;
+				ok = false;
+			}
+
+			if ( !ok )
+				return false;
+		}
+
+		if ( options.iterations == 0 || options.width == 0 || options.height == 0 )
+		{
+			std::cerr << "--iterations, --width and --height must be above 0" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string EscapeJson( const char* text )
+	{
+		std::string result;
+		for ( const char* c = text; nullptr != c && *c; c++ )
+		{
+			if ( *c == '"' || *c == '\\' )
+				result += '\\';
+
+			if ( uint8_t( *c ) >= 0x20 )
+				result += *c;
+		}
+
+		return result;
+	}
+
+	DeviceManager* CreateDeviceManager( const BenchOptions& options )
+	{
+		if ( options.null )
+			return DeviceManager::CreateNull( nvrhi::GraphicsAPI::VULKAN );
+
+		return DeviceManager::Create( nvrhi::GraphicsAPI::VULKAN );
+	}
+
+	void RunFrame( DeviceManager* deviceManager )
+	{
+		deviceManager->BeginFrame();
+		deviceManager->Present();
+	}
+}
+
+int main( int argc, char** argv )
+{
+	BenchOptions options;
+	if ( !ParseArguments( argc, argv, options ) )
+		return 1;
+
+	if ( !options.tracePath.empty() && !Trace::IsEnabled() )
+	{
+		std::cerr << "--trace needs a build with ELR_ENABLE_TRACE" << std::endl;
+		return 1;
+	}
+
+	BenchMessageCallback messageCallback;
+
+	DeviceCreationParameters params;
+	params.messageCallback = &messageCallback;
+	// don't let info messages into the timings at all
+	params.minLogSeverity = nvrhi::MessageSeverity::Warning;
+	params.headless = true;
+	params.backBufferWidth = options.width;
+	params.backBufferHeight = options.height;
+	params.vsyncEnabled = options.vsync;
+	params.enableDebugRuntime = options.validation;
+	params.enableNvrhiValidationLayer = options.validation;
+	params.nullGpuFrameTime = options.gpuFrameTimeMs / 1000.0;
+
+	Distribution create;
+	Distribution shutdown;
+	Distribution frame;
+	Distribution resize;
+	std::string renderer;
+	// only covers the measured frames
+	std::ostringstream blocking;
+
+	// Device lifecycle, a fresh DeviceManager every time
+	for ( uint32_t i = 0; i < options.iterations; i++ )
+	{
+		DeviceManager* deviceManager = CreateDeviceManager( options );
+		if ( nullptr == deviceManager )
+			return 1;
+
+		Stopwatch createTimer;
+		if ( !deviceManager->CreateWindowDeviceAndSwapChain( params ) )
+		{
+			std::cerr << "Failed to create the device" << std::endl;
+			delete deviceManager;
+			return 1;
+		}
+		create.Add( createTimer.ElapsedMilliseconds() );
+
+		// make sure there's some submitted work to tear down
+		RunFrame( deviceManager );
+
+		Stopwatch shutdownTimer;
+		deviceManager->Shutdown();
+		shutdown.Add( shutdownTimer.ElapsedMilliseconds() );
+
+		delete deviceManager;
+	}
+
+	// Frame loop and resizing share one device
+	DeviceManager* deviceManager = CreateDeviceManager( options );
+	if ( nullptr == deviceManager )
+		return 1;
+
+	if ( !deviceManager->CreateWindowDeviceAndSwapChain( params ) )
+	{
+		std::cerr << "Failed to create the device" << std::endl;
+		delete deviceManager;
+		return 1;
+	}
+
+	renderer = deviceManager->GetRendererString();
+
+	for ( uint32_t i = 0; i < options.warmupFrames; i++ )
+	{
+		RunFrame( deviceManager );
+	}
+
+	deviceManager->ResetBlockingTimeHistograms();
+
+	for ( uint32_t i = 0; i < options.frames; i++ )
+	{
+		Stopwatch frameTimer;
+		RunFrame( deviceManager );
+		frame.Add( frameTimer.ElapsedMilliseconds() );
+	}
+
+	for ( uint32_t call = 0; call < BlockingCalls::Count; call++ )
+	{
+		const BlockingTimeHistogram& histogram = deviceManager->GetBlockingTimeHistogram( BlockingCalls::Type( call ) );
+		blocking << (call == 0 ? "" : ",\n") << "\t\t\"" << BlockingCalls::Names[call] << "\": "
+			<< "{ \"samples\": " << histogram.GetTotalCount()
+			<< ", \"total\": " << histogram.GetTotalSeconds() * 1000.0
+			<< ", \"max\": " << histogram.GetMaxSeconds() * 1000.0
+			<< ", \"p50\": " << histogram.GetPercentile( 0.50 ) * 1000.0
+			<< ", \"p99\": " << histogram.GetPercentile( 0.99 ) * 1000.0
+			<< " }";
+	}
+
+	for ( uint32_t i = 0; i < options.iterations; i++ )
+	{
+		// alternate between two sizes so every call actually recreates the swap chain
+		const int width = int( options.width ) + ((i % 2 == 0) ? 16 : 0);
+		const int height = int( options.height ) + ((i % 2 == 0) ? 16 : 0);
+
+		Stopwatch resizeTimer;
+		deviceManager->UpdateWindowSize( width, height );
+		resize.Add( resizeTimer.ElapsedMilliseconds() );
+
+		// lets the old swap chain be released like it would in a real frame loop
+		RunFrame( deviceManager );
+	}
+
+	deviceManager->Shutdown();
+	delete deviceManager;
+
+	std::ostringstream json;
+	json << "{\n"
+		<< "\t\"renderer\": \"" << EscapeJson( renderer.c_str() ) << "\",\n"
+		<< "\t\"api\": \"" << (options.null ? "NULL" : "VULKAN") << "\",\n"
+		<< "\t\"gpuFrameTime\": " << (options.null ? options.gpuFrameTimeMs : 0.0) << ",\n"
+		<< "\t\"width\": " << options.width << ",\n"
+		<< "\t\"height\": " << options.height << ",\n"
+		<< "\t\"vsync\": " << (options.vsync ? "true" : "false") << ",\n"
+		<< "\t\"validation\": " << (options.validation ? "true" : "false") << ",\n"
+		<< "\t\"unit\": \"ms\",\n"
+		<< "\t\"scenarios\": {\n";
+
+	json << "\t\t\"create\": ";
+	create.WriteJson( json );
+	json << ",\n\t\t\"frame\": ";
+	frame.WriteJson( json );
+	json << ",\n\t\t\"resize\": ";
+	resize.WriteJson( json );
+	json << ",\n\t\t\"shutdown\": ";
+	shutdown.WriteJson( json );
+	json << "\n\t},\n"
+		<< "\t\"blocking\": {\n" << blocking.str() << "\n\t}\n}\n";
+
+	if ( options.outputPath.empty() )
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream file( options.outputPath );
+		if ( !file )
+		{
+			std::cerr << "Can't write to " << options.outputPath << std::endl;
+			return 1;
+		}
+
+		file << json.str();
+	}
+
+	if ( !options.tracePath.empty() )
+	{
+		const std::string& path = options.tracePath;
+		const bool chromeJson = path.size() >= 5 && path.compare( path.size() - 5, 5, ".json" ) == 0;
+		if ( !(chromeJson ? Trace::WriteChromeJson( path ) : Trace::WritePerfetto( path )) )
+		{
+			std::cerr << "Can't write the trace to " << path << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
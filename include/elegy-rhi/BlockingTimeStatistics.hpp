@@ -0,0 +1,86 @@
+// How long the frame loop spends blocked in the backend, fed by the DeviceManager on every wait
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace nvrhi::app
+{
+	// The calls in the frame loop that can block for a long time
+	struct BlockingCalls
+	{
+		enum Type : uint32_t
+		{
+			// waiting for a swap chain image in BeginFrame, the presentation engine is holding on to them
+			AcquireImage = 0,
+			// the present call itself, some drivers block in it when their queue is full. With
+			// VK_EXT_swapchain_maintenance1 also the wait for the image's previous present to finish
+			Present,
+			// waiting for the compositor to show an earlier frame, see DeviceCreationParameters::enablePresentWait
+			PresentWait,
+			// waiting for the GPU to finish the frame GetFramesInFlight frames ago
+			FrameWait,
+
+			Count
+		};
+
+		static constexpr const char* Names[Count] =
+		{
+			"AcquireImage",
+			"Present",
+			"PresentWait",
+			"FrameWait",
+		};
+	};
+
+	// Time spent in each blocking call during one frame, in seconds. Calls a backend doesn't make stay at 0
+	struct FrameBlockingTimes
+	{
+		// see DeviceManager::GetFrameIndex
+		uint32_t frameIndex = 0;
+		// the CPU frame time of the same frame
+		double frameTime = 0.0;
+		std::array<double, BlockingCalls::Count> seconds{};
+	};
+
+	// Called at the end of every Present, on the thread that presents
+	class IBlockingTimeCallback
+	{
+	public:
+		virtual ~IBlockingTimeCallback() = default;
+		virtual void OnFrameBlockingTimes( const FrameBlockingTimes& times ) = 0;
+	};
+
+	// Counts of wait times in log-scale buckets: bucket 0 holds waits under 1 microsecond, bucket i
+	// the ones from 2^(i-1) up to 2^i microseconds, and the last one everything longer.
+	// One thread adds samples, any thread can read them at any time
+	class BlockingTimeHistogram
+	{
+	public:
+		// the last regular bucket ends at 2^22 microseconds, a bit over 4 seconds
+		static constexpr uint32_t NumBuckets = 24;
+
+		void AddSample( uint64_t nanoseconds );
+		void Reset();
+
+		[[nodiscard]] uint64_t GetBucketCount( uint32_t bucket ) const { return m_Buckets[bucket].load( std::memory_order_relaxed ); }
+		[[nodiscard]] uint64_t GetTotalCount() const { return m_TotalCount.load( std::memory_order_relaxed ); }
+		[[nodiscard]] double GetTotalSeconds() const { return double( m_TotalNanoseconds.load( std::memory_order_relaxed ) ) * 1e-9; }
+		[[nodiscard]] double GetMaxSeconds() const { return double( m_MaxNanoseconds.load( std::memory_order_relaxed ) ) * 1e-9; }
+
+		// The upper end of the bucket the given fraction (0 to 1) of samples falls in, in seconds.
+		// Coarse by design, a power of two off at most
+		[[nodiscard]] double GetPercentile( double fraction ) const;
+
+		// In seconds, the last bucket reports the longest sample instead of infinity
+		[[nodiscard]] double GetBucketUpperBound( uint32_t bucket ) const;
+
+	private:
+		std::array<std::atomic<uint64_t>, NumBuckets> m_Buckets{};
+		std::atomic<uint64_t> m_TotalCount{ 0 };
+		std::atomic<uint64_t> m_TotalNanoseconds{ 0 };
+		std::atomic<uint64_t> m_MaxNanoseconds{ 0 };
+	};
+}
@@ -1,270 +1,567 @@
-/*
-* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
-*
-* Permission is hereby granted, free of charge, to any person obtaining a
-* copy of this software and associated documentation files (the "Software"),
-* to deal in the Software without restriction, including without limitation
-* the rights to use, copy, modify, merge, publish, distribute, sublicense,
-* and/or sell copies of the Software, and to permit persons to whom the
-* Software is furnished to do so, subject to the following conditions:
-*
-* The above copyright notice and this permission notice shall be included in
-* all copies or substantial portions of the Software.
-*
-* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
-* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
-* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
-* DEALINGS IN THE SOFTWARE.
-*/
-
-// Adapted from Donut's DeviceManager:
-// https://github.com/NVIDIAGameWorks/donut/blob/main/include/donut/app/DeviceManager.h
-// Removed all GLFW references so this can be usable in SDL2 as well, but not limited to any
-// Also removed some graphics API-specific includes (e.g. DXGI.h) to speed up compile times
-
-#pragma once
-
-#if VK_USE_PLATFORM_WIN32_KHR
-
-#include <Windows.h>
-
-#elif VK_USE_PLATFORM_XLIB_KHR
-
-#include <X11/Xlib.h>
-
-#elif VK_USE_PLATFORM_WAYLAND_KHR
-
-#include <wayland-client-core.h>
-
-#endif
-
-#include <nvrhi/nvrhi.h>
-
-struct IDXGIAdapter;
-
-namespace nvrhi::app
-{
-	struct FormatInfo
-	{
-		nvrhi::Format format;
-		uint32_t redBits;
-		uint32_t greenBits;
-		uint32_t blueBits;
-		uint32_t alphaBits;
-		uint32_t depthBits;
-		uint32_t stencilBits;
-	};
-
-	// Read more:
-	// https://docs.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-devices-downlevel-intro
-	struct Direct3DFeatureLevels
-	{
-		enum Type
-		{
-			L11_0 = 0,
-			L11_1,
-			L12_0,
-			L12_1,
-		};
-	};
-
-	// You'll need to set up your window's format bits according to this
-	constexpr FormatInfo FormatInfos[]
-	{
-		{ nvrhi::Format::UNKNOWN,            0,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::R8_UINT,            8,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::RG8_UINT,           8,  8,  0,  0,  0,  0, },
-		{ nvrhi::Format::RG8_UNORM,          8,  8,  0,  0,  0,  0, },
-		{ nvrhi::Format::R16_UINT,          16,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::R16_UNORM,         16,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::R16_FLOAT,         16,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::RGBA8_UNORM,        8,  8,  8,  8,  0,  0, },
-		{ nvrhi::Format::RGBA8_SNORM,        8,  8,  8,  8,  0,  0, },
-		{ nvrhi::Format::BGRA8_UNORM,        8,  8,  8,  8,  0,  0, },
-		{ nvrhi::Format::SRGBA8_UNORM,       8,  8,  8,  8,  0,  0, },
-		{ nvrhi::Format::SBGRA8_UNORM,       8,  8,  8,  8,  0,  0, },
-		{ nvrhi::Format::R10G10B10A2_UNORM, 10, 10, 10,  2,  0,  0, },
-		{ nvrhi::Format::R11G11B10_FLOAT,   11, 11, 10,  0,  0,  0, },
-		{ nvrhi::Format::RG16_UINT,         16, 16,  0,  0,  0,  0, },
-		{ nvrhi::Format::RG16_FLOAT,        16, 16,  0,  0,  0,  0, },
-		{ nvrhi::Format::R32_UINT,          32,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::R32_FLOAT,         32,  0,  0,  0,  0,  0, },
-		{ nvrhi::Format::RGBA16_FLOAT,      16, 16, 16, 16,  0,  0, },
-		{ nvrhi::Format::RGBA16_UNORM,      16, 16, 16, 16,  0,  0, },
-		{ nvrhi::Format::RGBA16_SNORM,      16, 16, 16, 16,  0,  0, },
-		{ nvrhi::Format::RG32_UINT,         32, 32,  0,  0,  0,  0, },
-		{ nvrhi::Format::RG32_FLOAT,        32, 32,  0,  0,  0,  0, },
-		{ nvrhi::Format::RGB32_UINT,        32, 32, 32,  0,  0,  0, },
-		{ nvrhi::Format::RGB32_FLOAT,       32, 32, 32,  0,  0,  0, },
-		{ nvrhi::Format::RGBA32_UINT,       32, 32, 32, 32,  0,  0, },
-		{ nvrhi::Format::RGBA32_FLOAT,      32, 32, 32, 32,  0,  0, },
-	};
-
-	struct WindowSurfaceData
-	{
-#if VK_USE_PLATFORM_WIN32_KHR || USE_DX11 || USE_DX12
-		HINSTANCE hInstance{};
-		HWND hWindow{};
-#elif VK_USE_PLATFORM_XLIB_KHR
-		Display* display{ nullptr };
-		Window window{};
-#elif VK_USE_PLATFORM_WAYLAND_KHR
-		wl_display* display{ nullptr };
-		wl_surface* surface{ nullptr };
-#endif
-	};
-
-	struct DeviceCreationParameters
-	{
-		nvrhi::IMessageCallback* messageCallback = nullptr;
-		std::vector<std::string> frameworkExtensions;
-		WindowSurfaceData windowSurfaceData;
-
-		bool startMaximized = false;
-		bool startFullscreen = false;
-		bool allowModeSwitch = true;
-
-		uint32_t backBufferWidth = 1280;
-		uint32_t backBufferHeight = 720;
-		uint32_t refreshRate = 0;
-		uint32_t swapChainBufferCount = 3;
-		nvrhi::Format swapChainFormat = nvrhi::Format::SRGBA8_UNORM;
-		uint32_t swapChainSampleCount = 1;
-		uint32_t swapChainSampleQuality = 0;
-		uint32_t maxFramesInFlight = 2;
-		bool enableDebugRuntime = false;
-		bool enableNvrhiValidationLayer = false;
-		bool vsyncEnabled = false;
-		bool enableRayTracingExtensions = false; // for vulkan
-		bool enableComputeQueue = false;
-		bool enableCopyQueue = false;
-
-		// Severity of the information log messages from the device manager, like the device name or enabled extensions.
-		nvrhi::MessageSeverity infoLogSeverity = nvrhi::MessageSeverity::Info;
-
-#if USE_DX11 || USE_DX12
-		// Adapter to create the device on. Setting this to non-null overrides adapterNameSubstring.
-		// If device creation fails on the specified adapter, it will *not* try any other adapters.
-		IDXGIAdapter* adapter = nullptr;
-#endif
-
-		// For use in the case of multiple adapters; only effective if 'adapter' is null. If this is non-null, device creation will try to match
-		// the given string against an adapter name.  If the specified string exists as a sub-string of the
-		// adapter name, the device and window will be created on that adapter. Case sensitive.
-		std::wstring adapterNameSubstring = L"";
-
-#if USE_DX11 || USE_DX12
-		//DXGI_USAGE swapChainUsage = DXGI_USAGE_SHADER_INPUT | DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		Direct3DFeatureLevels::Type featureLevel = Direct3DFeatureLevels::L11_1;
-#endif
-
-#if USE_VK
-		std::vector<std::string> requiredVulkanInstanceExtensions;
-		std::vector<std::string> requiredVulkanDeviceExtensions;
-		std::vector<std::string> requiredVulkanLayers;
-		std::vector<std::string> optionalVulkanInstanceExtensions;
-		std::vector<std::string> optionalVulkanDeviceExtensions;
-		std::vector<std::string> optionalVulkanLayers;
-		std::vector<size_t> ignoredVulkanValidationMessageLocations;
-#endif
-	};
-
-	class DeviceManager
-	{
-	public:
-		static DeviceManager* Create( nvrhi::GraphicsAPI api );
-
-		bool CreateWindowDeviceAndSwapChain( const DeviceCreationParameters& params );
-
-		void UpdateWindowSize( int width, int height );
-
-		// returns the size of the window in screen coordinates
-		void GetWindowDimensions( int& width, int& height );
-		// returns the screen coordinate to pixel coordinate scale factor
-		void GetDPIScaleInfo( float& x, float& y ) const
-		{
-			x = m_DPIScaleFactorX;
-			y = m_DPIScaleFactorY;
-		}
-
-	protected:
-		bool m_windowVisible = false;
-
-		DeviceCreationParameters m_DeviceParams;
-		void* m_Window = nullptr;
-		// set to true if running on NV GPU
-		bool m_IsNvidia = false;
-		// timestamp in seconds for the previous frame
-		double m_PreviousFrameTimestamp = 0.0;
-		// current DPI scale info (updated when window moves)
-		float m_DPIScaleFactorX = 1.f;
-		float m_DPIScaleFactorY = 1.f;
-		bool m_RequestedVSync = false;
-
-		double m_AverageFrameTime = 0.0;
-		double m_AverageTimeUpdateInterval = 0.5;
-		double m_FrameTimeSum = 0.0;
-		int m_NumberOfAccumulatedFrames = 0;
-
-		uint32_t m_FrameIndex = 0;
-
-		std::vector<nvrhi::FramebufferHandle> m_SwapChainFramebuffers;
-
-		DeviceManager() = default;
-
-		void BackBufferResizing();
-		void BackBufferResized();
-
-		// device-specific methods
-		virtual bool CreateDeviceAndSwapChain() = 0;
-		virtual void DestroyDeviceAndSwapChain() = 0;
-		virtual void ResizeSwapChain() = 0;
-	public:
-		virtual void BeginFrame() = 0;
-		virtual void Present() = 0;
-
-		[[nodiscard]] virtual nvrhi::IDevice* GetDevice() const = 0;
-		[[nodiscard]] virtual const char* GetRendererString() const = 0;
-		[[nodiscard]] virtual nvrhi::GraphicsAPI GetGraphicsAPI() const = 0;
-
-		void Message( const char* message, nvrhi::MessageSeverity severity = nvrhi::MessageSeverity::Info );
-		void Error( const char* message );
-		void Fatal( const char* message );
-
-		const DeviceCreationParameters& GetDeviceParams();
-		[[nodiscard]] double GetAverageFrameTimeSeconds() const { return m_AverageFrameTime; }
-		[[nodiscard]] double GetPreviousFrameTimestamp() const { return m_PreviousFrameTimestamp; }
-		void SetFrameTimeUpdateInterval( double seconds ) { m_AverageTimeUpdateInterval = seconds; }
-		[[nodiscard]] bool IsVsyncEnabled() const { return m_DeviceParams.vsyncEnabled; }
-		virtual void SetVsyncEnabled( bool enabled ) { m_RequestedVSync = enabled; /* will be processed later */ }
-		virtual void ReportLiveObjects() {}
-
-		[[nodiscard]] void* GetWindow() const { return m_Window; }
-		[[nodiscard]] uint32_t GetFrameIndex() const { return m_FrameIndex; }
-
-		virtual nvrhi::ITexture* GetCurrentBackBuffer() = 0;
-		virtual nvrhi::ITexture* GetBackBuffer( uint32_t index ) = 0;
-		virtual uint32_t GetCurrentBackBufferIndex() = 0;
-		virtual uint32_t GetBackBufferCount() = 0;
-		nvrhi::IFramebuffer* GetCurrentFramebuffer();
-		nvrhi::IFramebuffer* GetFramebuffer( uint32_t index );
-
-		void Shutdown();
-		virtual ~DeviceManager() = default;
-
-		virtual bool IsVulkanInstanceExtensionEnabled( const char* extensionName ) const { return false; }
-		virtual bool IsVulkanDeviceExtensionEnabled( const char* extensionName ) const { return false; }
-		virtual bool IsVulkanLayerEnabled( const char* layerName ) const { return false; }
-		virtual void GetEnabledVulkanInstanceExtensions( std::vector<std::string>& extensions ) const {}
-		virtual void GetEnabledVulkanDeviceExtensions( std::vector<std::string>& extensions ) const {}
-		virtual void GetEnabledVulkanLayers( std::vector<std::string>& layers ) const {}
-
-	private:
-		static DeviceManager* CreateD3D11();
-		static DeviceManager* CreateD3D12();
-		static DeviceManager* CreateVK();
-	};
-}
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+// Adapted from Donut's DeviceManager:
+// https://github.com/NVIDIAGameWorks/donut/blob/main/include/donut/app/DeviceManager.h
+// Removed all GLFW references so this can be usable in SDL2 as well, but not limited to any
+// Also removed some graphics API-specific includes (e.g. DXGI.h) to speed up compile times
+
+#pragma once
+
+#if VK_USE_PLATFORM_WIN32_KHR
+
+#include <Windows.h>
+
+#elif VK_USE_PLATFORM_XLIB_KHR
+
+#include <X11/Xlib.h>
+
+#elif VK_USE_PLATFORM_WAYLAND_KHR
+
+#include <wayland-client-core.h>
+
+#endif
+
+#include <nvrhi/nvrhi.h>
+
+#include "elegy-rhi/BlockingTimeStatistics.hpp"
+#include "elegy-rhi/FrameTimeStatistics.hpp"
+#include "elegy-rhi/FramesInFlightController.hpp"
+#include "elegy-rhi/GpuProfiler.hpp"
+#include "elegy-rhi/Logger.hpp"
+#include "elegy-rhi/VulkanExtensions.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+struct IDXGIAdapter;
+
+namespace nvrhi::app
+{
+	struct FormatInfo
+	{
+		nvrhi::Format format;
+		uint32_t redBits;
+		uint32_t greenBits;
+		uint32_t blueBits;
+		uint32_t alphaBits;
+		uint32_t depthBits;
+		uint32_t stencilBits;
+	};
+
+	// Read more:
+	// https://docs.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-devices-downlevel-intro
+	struct Direct3DFeatureLevels
+	{
+		enum Type
+		{
+			L11_0 = 0,
+			L11_1,
+			L12_0,
+			L12_1,
+		};
+	};
+
+	struct PresentModes
+	{
+		enum Type
+		{
+			// No vsync, may tear
+			Immediate = 0,
+			// No tearing, the newest frame replaces the one waiting for vblank
+			Mailbox,
+			// Regular vsync
+			Fifo,
+			// vsync, but late frames are presented immediately instead of waiting for the next vblank
+			FifoRelaxed,
+		};
+	};
+
+	// Groups of checks in VK_LAYER_KHRONOS_validation, see DeviceCreationParameters::vulkanValidationChecks
+	struct VulkanValidationChecks
+	{
+		enum Type : uint32_t
+		{
+			// the bulk of the valid usage checks
+			Core = 1 << 0,
+			// parameters that can be checked without any state
+			Stateless = 1 << 1,
+			ObjectLifetime = 1 << 2,
+			ThreadSafety = 1 << 3,
+			// SPIR-V validation when shader modules are created
+			Shaders = 1 << 4,
+			// synchronisation validation, expensive
+			Synchronization = 1 << 5,
+			BestPractices = 1 << 6,
+			// GPU-assisted validation, very expensive
+			GpuAssisted = 1 << 7,
+
+			// what the layer does when left alone
+			Default = Core | Stateless | ObjectLifetime | ThreadSafety | Shaders,
+			// cheap enough to leave on while profiling
+			Light = Stateless | ObjectLifetime
+		};
+	};
+
+	// You'll need to set up your window's format bits according to this
+	constexpr FormatInfo FormatInfos[]
+	{
+		{ nvrhi::Format::UNKNOWN,            0,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::R8_UINT,            8,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::RG8_UINT,           8,  8,  0,  0,  0,  0, },
+		{ nvrhi::Format::RG8_UNORM,          8,  8,  0,  0,  0,  0, },
+		{ nvrhi::Format::R16_UINT,          16,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::R16_UNORM,         16,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::R16_FLOAT,         16,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::RGBA8_UNORM,        8,  8,  8,  8,  0,  0, },
+		{ nvrhi::Format::RGBA8_SNORM,        8,  8,  8,  8,  0,  0, },
+		{ nvrhi::Format::BGRA8_UNORM,        8,  8,  8,  8,  0,  0, },
+		{ nvrhi::Format::SRGBA8_UNORM,       8,  8,  8,  8,  0,  0, },
+		{ nvrhi::Format::SBGRA8_UNORM,       8,  8,  8,  8,  0,  0, },
+		{ nvrhi::Format::R10G10B10A2_UNORM, 10, 10, 10,  2,  0,  0, },
+		{ nvrhi::Format::R11G11B10_FLOAT,   11, 11, 10,  0,  0,  0, },
+		{ nvrhi::Format::RG16_UINT,         16, 16,  0,  0,  0,  0, },
+		{ nvrhi::Format::RG16_FLOAT,        16, 16,  0,  0,  0,  0, },
+		{ nvrhi::Format::R32_UINT,          32,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::R32_FLOAT,         32,  0,  0,  0,  0,  0, },
+		{ nvrhi::Format::RGBA16_FLOAT,      16, 16, 16, 16,  0,  0, },
+		{ nvrhi::Format::RGBA16_UNORM,      16, 16, 16, 16,  0,  0, },
+		{ nvrhi::Format::RGBA16_SNORM,      16, 16, 16, 16,  0,  0, },
+		{ nvrhi::Format::RG32_UINT,         32, 32,  0,  0,  0,  0, },
+		{ nvrhi::Format::RG32_FLOAT,        32, 32,  0,  0,  0,  0, },
+		{ nvrhi::Format::RGB32_UINT,        32, 32, 32,  0,  0,  0, },
+		{ nvrhi::Format::RGB32_FLOAT,       32, 32, 32,  0,  0,  0, },
+		{ nvrhi::Format::RGBA32_UINT,       32, 32, 32, 32,  0,  0, },
+		{ nvrhi::Format::RGBA32_FLOAT,      32, 32, 32, 32,  0,  0, },
+	};
+
+	struct WindowSurfaceData
+	{
+#if VK_USE_PLATFORM_WIN32_KHR || USE_DX11 || USE_DX12
+		HINSTANCE hInstance{};
+		HWND hWindow{};
+#elif VK_USE_PLATFORM_XLIB_KHR
+		Display* display{ nullptr };
+		Window window{};
+#elif VK_USE_PLATFORM_WAYLAND_KHR
+		wl_display* display{ nullptr };
+		wl_surface* surface{ nullptr };
+#endif
+	};
+
+	// What the device ended up with. Optional features are enabled whenever the device supports them,
+	// so these are the things that are safe to use. Only the Vulkan backend fills this in for now
+	struct DeviceCapabilities
+	{
+		// VK_API_VERSION_*, the lower of what the device and the instance support
+		uint32_t vulkanApiVersion = 0;
+
+		bool timelineSemaphore = false;
+		bool descriptorIndexing = false;
+		bool bufferDeviceAddress = false;
+		// Vulkan 1.3, needs VK_API_VERSION_1_3 in the headers at build time as well
+		bool synchronization2 = false;
+		bool maintenance4 = false;
+		// or VK_KHR_dynamic_rendering on 1.2 devices, if DeviceCreationParameters::enableDynamicRendering asked for it
+		bool dynamicRendering = false;
+
+		bool accelerationStructure = false;
+		bool rayTracingPipeline = false;
+		bool rayQuery = false;
+		bool meshShader = false;
+		bool variableRateShading = false;
+
+		bool presentWait = false;
+		bool swapChainMaintenance1 = false;
+	};
+
+	struct DeviceCreationParameters
+	{
+		nvrhi::IMessageCallback* messageCallback = nullptr;
+		// Gets the time spent in each blocking call after every frame, see GetBlockingTimeHistogram
+		IBlockingTimeCallback* blockingTimeCallback = nullptr;
+		std::vector<std::string> frameworkExtensions;
+		WindowSurfaceData windowSurfaceData;
+
+		bool startMaximized = false;
+		bool startFullscreen = false;
+		bool allowModeSwitch = true;
+		// Don't create a window surface or swap chain, render into a ring of swapChainBufferCount
+		// offscreen images instead. windowSurfaceData is ignored. Vulkan only, works with lavapipe
+		bool headless = false;
+
+		uint32_t backBufferWidth = 1280;
+		uint32_t backBufferHeight = 720;
+		uint32_t refreshRate = 0;
+		uint32_t swapChainBufferCount = 3;
+		nvrhi::Format swapChainFormat = nvrhi::Format::SRGBA8_UNORM;
+		uint32_t swapChainSampleCount = 1;
+		uint32_t swapChainSampleQuality = 0;
+		// Present returns once at most this many frames, the one it just submitted included, are unfinished on
+		// the GPU. Before the frame timeline semaphore (Vulkan only back then) one more frame could be left
+		// unfinished, raise this by one to get the old amount of overlap back. Vulkan and null backends
+		uint32_t maxFramesInFlight = 2;
+		// Lets the frames in flight limit move between minFramesInFlight and maxFramesInFlight at runtime, going by the
+		// CPU frame time, how long Present waits for the GPU and whether the GPU runs out of queued frames.
+		// See FramesInFlightController and GetFramesInFlight (Vulkan and null backends)
+		bool adaptiveFramesInFlight = false;
+		uint32_t minFramesInFlight = 1;
+		// Null backend only: how long the simulated GPU takes per frame, in seconds
+		double nullGpuFrameTime = 0.0;
+		// Lets BeginFrame wait until the display has actually picked up the frame presented
+		// maxQueuedFrames frames ago, which bounds latency by what's on screen rather than by GPU completion.
+		// Needs VK_KHR_present_id and VK_KHR_present_wait, see IsPresentWaitEnabled (Vulkan only)
+		bool enablePresentWait = false;
+		// 0 turns the present wait off, can be changed at runtime with SetMaxQueuedFrames
+		uint32_t maxQueuedFrames = 1;
+		bool enableDebugRuntime = false;
+		bool enableNvrhiValidationLayer = false;
+		// Report sampling for validation messages (from the debug runtime and the NVRHI validation layer): warnings
+		// and info are only reported on every Nth frame and on frames asked for with RequestValidationReportFrame,
+		// the other frames drop them right away. Errors are always reported. This only thins out the reporting,
+		// the checks themselves run on every frame either way, see vulkanValidationChecks for making those cheaper.
+		// 0 and 1 report everything
+		uint32_t validationReportSampleInterval = 1;
+		bool vsyncEnabled = false;
+		// Present modes to try in order, the first one the surface supports wins (Vulkan only).
+		// With vsync on, only Fifo and FifoRelaxed are considered. If nothing matches, Fifo is used.
+		// Empty means Immediate (then Mailbox) without vsync, and Fifo with vsync
+		std::vector<PresentModes::Type> presentModePreference;
+		bool enableRayTracingExtensions = false; // for vulkan
+		bool enableComputeQueue = false;
+		// Creates a GpuProfiler, see DeviceManager::GetGpuProfiler
+		bool enableGpuProfiler = false;
+		// For renderers that draw to the back buffers with dynamic rendering (Vulkan 1.3 or VK_KHR_dynamic_rendering)
+		// instead of framebuffers: the swap chain framebuffers are then only created when GetFramebuffer asks for them.
+		// See IsDynamicRenderingEnabled, it stays off if the device can't do it (Vulkan only)
+		bool enableDynamicRendering = false;
+		bool enableCopyQueue = false;
+
+		// Severity of the information log messages from the device manager, like the device name or enabled extensions.
+		nvrhi::MessageSeverity infoLogSeverity = nvrhi::MessageSeverity::Info;
+		// Messages below this severity are thrown away before they are even formatted.
+		// Note that the messageCallback is called from a logging thread, see Logger
+		nvrhi::MessageSeverity minLogSeverity = nvrhi::MessageSeverity::Info;
+
+#if USE_DX11 || USE_DX12
+		// Adapter to create the device on. Setting this to non-null overrides adapterNameSubstring.
+		// If device creation fails on the specified adapter, it will *not* try any other adapters.
+		IDXGIAdapter* adapter = nullptr;
+#endif
+
+		// For use in the case of multiple adapters; only effective if 'adapter' is null. If this is non-null, device creation will try to match
+		// the given string against an adapter name.  If the specified string exists as a sub-string of the
+		// adapter name, the device and window will be created on that adapter. Case sensitive.
+		std::wstring adapterNameSubstring = L"";
+
+#if USE_DX11 || USE_DX12
+		//DXGI_USAGE swapChainUsage = DXGI_USAGE_SHADER_INPUT | DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		Direct3DFeatureLevels::Type featureLevel = Direct3DFeatureLevels::L11_1;
+#endif
+
+#if USE_VK
+		std::vector<std::string> requiredVulkanInstanceExtensions;
+		std::vector<std::string> requiredVulkanDeviceExtensions;
+		std::vector<std::string> requiredVulkanLayers;
+		std::vector<std::string> optionalVulkanInstanceExtensions;
+		std::vector<std::string> optionalVulkanDeviceExtensions;
+		std::vector<std::string> optionalVulkanLayers;
+		// Validation messages to drop before anything is formatted, by messageIdNumber or by name
+		// (the VUID, like "VUID-vkCmdDraw-None-02859"). Other messages are reported the first time they come up for
+		// a set of objects, after that only a count of the repeats is reported, once per frame. A message that
+		// stays away for a couple of seconds' worth of frames is reported in full again the next time
+		std::vector<int32_t> ignoredVulkanValidationMessageIds;
+		std::vector<std::string> ignoredVulkanValidationMessageNames;
+		// Same as ignoredVulkanValidationMessageIds, the validation layer used to pass the message ID
+		// as the location back when messages came through VK_EXT_debug_report
+		std::vector<size_t> ignoredVulkanValidationMessageLocations;
+
+		// Drain the present queue after every present. Frame pacing normally relies on semaphores only,
+		// this brings back the old (slow) behaviour for when you are hunting synchronisation bugs
+		bool vulkanWaitIdleAfterPresent = false;
+
+		// VulkanValidationChecks the validation layer runs with enableDebugRuntime. They are fixed when
+		// the instance is created, and need a layer with VK_EXT_layer_settings, otherwise its own settings stay
+		uint32_t vulkanValidationChecks = VulkanValidationChecks::Default;
+
+		// Directory to keep the VkPipelineCache in between runs, with one file per GPU and driver version.
+		// The cache is written back on Shutdown and by SavePipelineCache. Empty means it isn't persisted
+		std::string pipelineCachePath;
+
+		// File to remember the picked physical device in. As long as the same devices and drivers are present
+		// and the requirements are the same, the next start only checks that device's extensions, features, queues
+		// and surface support instead of every device's, and falls back to the full scan if it fails them.
+		// The properties of every device are still read to tell whether anything changed. Empty disables the cache
+		std::string vulkanDeviceSelectionCachePath;
+
+		// Give the instance, the device and everything created from them our own host allocator:
+		// small driver allocations come out of pools, and ReportLiveObjects prints the host memory
+		// still held per allocation scope. Off by default, as some drivers don't expect it
+		bool vulkanHostAllocationCallbacks = false;
+#endif
+	};
+
+	class DeviceManager
+	{
+	public:
+		static DeviceManager* Create( nvrhi::GraphicsAPI api );
+		// A backend without a GPU, for profiling the CPU side of the DeviceManager. GetDevice and
+		// the back buffers are null, GetGraphicsAPI reports emulatedApi. See nullGpuFrameTime
+		static DeviceManager* CreateNull( nvrhi::GraphicsAPI emulatedApi = nvrhi::GraphicsAPI::VULKAN );
+
+		bool CreateWindowDeviceAndSwapChain( const DeviceCreationParameters& params );
+
+		// Two-phase alternative to CreateWindowDeviceAndSwapChain, so the device can be brought up on another
+		// thread while the window is still being made. CreateDevice ignores params.windowSurfaceData, and the device
+		// is picked without knowing the surface, which then has to be presentable from the graphics queue.
+		// The time between the two calls is the warm-up window: GetDevice (and the pipeline cache, see
+		// pipelineCachePath) is ready as soon as CreateDevice returns, so shaders, pipelines and resources can be
+		// created while the window comes up, and keep being created after the surface is attached.
+		// AttachWindowSurface must not run before CreateDevice has returned.
+		// Exactly one surface per DeviceManager: presenting, frame pacing and resizing all work on a single
+		// swap chain, so a second AttachWindowSurface fails. Vulkan only, the null backend accepts it too
+		bool CreateDevice( const DeviceCreationParameters& params );
+		bool AttachWindowSurface( const WindowSurfaceData& surfaceData, int width, int height );
+
+		void UpdateWindowSize( int width, int height );
+
+		// returns the size of the window in screen coordinates
+		void GetWindowDimensions( int& width, int& height );
+		// returns the screen coordinate to pixel coordinate scale factor
+		void GetDPIScaleInfo( float& x, float& y ) const
+		{
+			x = m_DPIScaleFactorX;
+			y = m_DPIScaleFactorY;
+		}
+
+	protected:
+		bool m_windowVisible = false;
+
+		DeviceCreationParameters m_DeviceParams;
+		void* m_Window = nullptr;
+		// set to true if running on NV GPU
+		bool m_IsNvidia = false;
+		// timestamp in seconds for the previous frame
+		double m_PreviousFrameTimestamp = 0.0;
+		// current DPI scale info (updated when window moves)
+		float m_DPIScaleFactorX = 1.f;
+		float m_DPIScaleFactorY = 1.f;
+		bool m_RequestedVSync = false;
+		// the present mode the swap chain actually ended up with
+		PresentModes::Type m_PresentMode = PresentModes::Fifo;
+
+		double m_AverageFrameTime = 0.0;
+		double m_AverageTimeUpdateInterval = 0.5;
+		double m_FrameTimeSum = 0.0;
+		int m_NumberOfAccumulatedFrames = 0;
+
+		uint32_t m_FrameIndex = 0;
+
+		FrameTimeStatistics m_FrameTimeStatistics;
+		std::unique_ptr<GpuProfiler> m_GpuProfiler;
+		Logger m_Logger;
+
+		std::array<BlockingTimeHistogram, BlockingCalls::Count> m_BlockingTimeHistograms;
+		// adds up over the frame being recorded, goes to the blockingTimeCallback in UpdateFrameTime
+		FrameBlockingTimes m_FrameBlockingTimes;
+
+		FramesInFlightController m_FramesInFlightController;
+		// frames the GPU hadn't finished when the current one was submitted, see PrepareFrameWait
+		uint64_t m_FramesQueuedAtSubmit = 0;
+
+		// Backends call this in Present once the frame is submitted, right before waiting for the GPU.
+		// Returns the frame value to wait for to stay within GetFramesInFlight, 0 if there's no need to wait
+		uint64_t PrepareFrameWait();
+
+		// Put one of these right around a blocking call in the frame loop
+		class BlockingTimer
+		{
+		public:
+			BlockingTimer( DeviceManager& manager, BlockingCalls::Type call )
+				: m_Manager( manager ), m_Call( call ), m_Start( std::chrono::steady_clock::now() )
+			{
+			}
+
+			~BlockingTimer()
+			{
+				const auto elapsed = std::chrono::steady_clock::now() - m_Start;
+				m_Manager.RecordBlockingTime( m_Call, uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count() ) );
+			}
+
+			BlockingTimer( const BlockingTimer& ) = delete;
+			BlockingTimer& operator=( const BlockingTimer& ) = delete;
+
+		private:
+			DeviceManager& m_Manager;
+			BlockingCalls::Type m_Call;
+			std::chrono::steady_clock::time_point m_Start;
+		};
+
+		void RecordBlockingTime( BlockingCalls::Type call, uint64_t nanoseconds );
+
+		// Hand this to nvrhi instead of DeviceCreationParameters::messageCallback when its warnings should
+		// be sampled like validation messages, i.e. with the NVRHI validation layer
+		class SampledMessageCallback final : public nvrhi::IMessageCallback
+		{
+		public:
+			explicit SampledMessageCallback( DeviceManager& manager ) : m_Manager( manager ) {}
+			void message( nvrhi::MessageSeverity severity, const char* messageText ) override;
+
+		private:
+			DeviceManager& m_Manager;
+		};
+
+		SampledMessageCallback m_SampledMessageCallback{ *this };
+		// read from whatever thread validation messages come in on
+		std::atomic<bool> m_ValidationReportFrame{ true };
+		std::atomic<bool> m_ValidationReportFrameRequested{ false };
+
+		// nvrhi's message callback, the sampled one with the NVRHI validation layer and a sample interval
+		nvrhi::IMessageCallback* GetNvrhiMessageCallback();
+
+		DeviceCapabilities m_DeviceCapabilities;
+		bool m_DynamicRenderingEnabled = false;
+
+		std::vector<nvrhi::FramebufferHandle> m_SwapChainFramebuffers;
+
+		DeviceManager() = default;
+
+		void BackBufferResizing();
+		void BackBufferResized();
+
+		// Shared by the one- and two-phase creation paths
+		void DeviceCreated();
+		void SwapChainCreated( int width, int height );
+
+		// Backends call this at the end of Present to feed the frame timing
+		void UpdateFrameTime();
+
+		// Whether switching vsync on or off needs a new swap chain. D3D does it per present call,
+		// Vulkan only can with VK_EXT_swapchain_maintenance1 and compatible present modes
+		[[nodiscard]] virtual bool VSyncChangeRequiresResize( bool vsyncEnabled ) const { return false; }
+
+		// device-specific methods
+		virtual bool CreateDeviceAndSwapChain() = 0;
+		// For CreateDevice and AttachWindowSurface
+		virtual bool CreateDeviceOnly();
+		virtual bool CreateWindowSurfaceAndSwapChain();
+		virtual void DestroyDeviceAndSwapChain() = 0;
+		virtual void ResizeSwapChain() = 0;
+	public:
+		virtual void BeginFrame() = 0;
+		virtual void Present() = 0;
+
+		[[nodiscard]] virtual nvrhi::IDevice* GetDevice() const = 0;
+		[[nodiscard]] virtual const char* GetRendererString() const = 0;
+		[[nodiscard]] virtual nvrhi::GraphicsAPI GetGraphicsAPI() const = 0;
+
+		void Message( const char* message, nvrhi::MessageSeverity severity = nvrhi::MessageSeverity::Info );
+		void Error( const char* message );
+		void Fatal( const char* message );
+		// printf-style, formatted on the logging thread. Errors are delivered before this returns
+		template<typename... Args>
+		void Log( nvrhi::MessageSeverity severity, const char* format, const Args&... args )
+		{
+			if ( severity >= m_DeviceParams.minLogSeverity )
+			{
+				m_Logger.Log( m_DeviceParams.messageCallback, severity, format, args... );
+			}
+		}
+
+		const DeviceCreationParameters& GetDeviceParams();
+		[[nodiscard]] double GetAverageFrameTimeSeconds() const { return m_AverageFrameTime; }
+		[[nodiscard]] double GetPreviousFrameTimestamp() const { return m_PreviousFrameTimestamp; }
+		void SetFrameTimeUpdateInterval( double seconds ) { m_AverageTimeUpdateInterval = seconds; }
+		// Rolling mean, min/max, percentiles and stutter counts of the CPU frame time.
+		// Safe to query from any thread
+		[[nodiscard]] FrameTimeStatistics& GetFrameTimeStatistics() { return m_FrameTimeStatistics; }
+		[[nodiscard]] const FrameTimeStatistics& GetFrameTimeStatistics() const { return m_FrameTimeStatistics; }
+		// Log-scale histogram of the time spent blocked in a call of the frame loop, since the last reset.
+		// A bad frame with long AcquireImage or PresentWait times was held up by the compositor, one with a long
+		// FrameWait by the GPU, and one with neither by the CPU. Safe to query from any thread
+		[[nodiscard]] const BlockingTimeHistogram& GetBlockingTimeHistogram( BlockingCalls::Type call ) const { return m_BlockingTimeHistograms[call]; }
+		void ResetBlockingTimeHistograms();
+		void SetBlockingTimeCallback( IBlockingTimeCallback* callback ) { m_DeviceParams.blockingTimeCallback = callback; }
+		// Null unless DeviceCreationParameters::enableGpuProfiler is set
+		[[nodiscard]] GpuProfiler* GetGpuProfiler() const { return m_GpuProfiler.get(); }
+		[[nodiscard]] const DeviceCapabilities& GetDeviceCapabilities() const { return m_DeviceCapabilities; }
+		// Whether DeviceCreationParameters::enableDynamicRendering took effect
+		[[nodiscard]] bool IsDynamicRenderingEnabled() const { return m_DynamicRenderingEnabled; }
+		[[nodiscard]] bool IsVsyncEnabled() const { return m_DeviceParams.vsyncEnabled; }
+		[[nodiscard]] PresentModes::Type GetPresentMode() const { return m_PresentMode; }
+		virtual void SetVsyncEnabled( bool enabled ) { m_RequestedVSync = enabled; /* will be processed later */ }
+		[[nodiscard]] virtual bool IsPresentWaitEnabled() const { return false; }
+		[[nodiscard]] uint32_t GetMaxQueuedFrames() const { return m_DeviceParams.maxQueuedFrames; }
+		void SetMaxQueuedFrames( uint32_t frames ) { m_DeviceParams.maxQueuedFrames = frames; }
+		// How many frames the GPU may lag behind right now, maxFramesInFlight unless adaptiveFramesInFlight is on
+		[[nodiscard]] uint32_t GetFramesInFlight() const;
+		// Starts over from maxFramesInFlight either way
+		void SetAdaptiveFramesInFlight( bool enabled );
+		// Reports all validation messages for the next frame, see DeviceCreationParameters::validationReportSampleInterval
+		void RequestValidationReportFrame() { m_ValidationReportFrameRequested.store( true, std::memory_order_relaxed ); }
+		// Whether validation warnings coming in now are reported, errors always are
+		[[nodiscard]] bool IsValidationReportFrame() const { return m_ValidationReportFrame.load( std::memory_order_relaxed ); }
+		virtual void ReportLiveObjects() {}
+		// Writes the pipeline cache to DeviceCreationParameters::pipelineCachePath right away, returns false
+		// if there is nothing to write or writing failed (Vulkan only)
+		virtual bool SavePipelineCache() { return false; }
+		// The VkPipelineCache, null on other backends
+		[[nodiscard]] virtual nvrhi::Object GetVulkanPipelineCache() const { return nullptr; }
+
+		[[nodiscard]] void* GetWindow() const { return m_Window; }
+		[[nodiscard]] uint32_t GetFrameIndex() const { return m_FrameIndex; }
+
+		// Monotonically increasing value of the last frame submitted through Present, starting at 1.
+		// Resources used by a frame can be reused once GetCompletedFrameValue() reaches that frame's value.
+		// Backends that don't track frame completion return 0 from both
+		[[nodiscard]] virtual uint64_t GetCurrentFrameValue() const { return 0; }
+		// Value of the last frame the GPU has finished executing
+		[[nodiscard]] virtual uint64_t GetCompletedFrameValue() const { return 0; }
+
+		virtual nvrhi::ITexture* GetCurrentBackBuffer() = 0;
+		virtual nvrhi::ITexture* GetBackBuffer( uint32_t index ) = 0;
+		virtual uint32_t GetCurrentBackBufferIndex() = 0;
+		virtual uint32_t GetBackBufferCount() = 0;
+		nvrhi::IFramebuffer* GetCurrentFramebuffer();
+		nvrhi::IFramebuffer* GetFramebuffer( uint32_t index );
+
+		void Shutdown();
+		virtual ~DeviceManager() = default;
+
+		virtual bool IsVulkanInstanceExtensionEnabled( const char* extensionName ) const { return false; }
+		virtual bool IsVulkanDeviceExtensionEnabled( const char* extensionName ) const { return false; }
+		// Same as above for the extensions in VulkanExtensions.hpp, without any string lookups
+		virtual bool IsVulkanInstanceExtensionEnabled( VulkanInstanceExtensions::Type extension ) const { return false; }
+		virtual bool IsVulkanDeviceExtensionEnabled( VulkanDeviceExtensions::Type extension ) const { return false; }
+		virtual bool IsVulkanLayerEnabled( const char* layerName ) const { return false; }
+		virtual void GetEnabledVulkanInstanceExtensions( std::vector<std::string>& extensions ) const {}
+		virtual void GetEnabledVulkanDeviceExtensions( std::vector<std::string>& extensions ) const {}
+		virtual void GetEnabledVulkanLayers( std::vector<std::string>& layers ) const {}
+
+	private:
+		static DeviceManager* CreateD3D11();
+		static DeviceManager* CreateD3D12();
+		static DeviceManager* CreateVK();
+	};
+}
@@ -0,0 +1,66 @@
+// Rolling CPU frame time statistics, fed by the DeviceManager on every Present
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace nvrhi::app
+{
+	// All times are in seconds and cover the last FrameTimeStatistics::MaxSamples frames at most
+	struct FrameTimeSummary
+	{
+		uint32_t numFrames = 0;
+		double mean = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		// frames in the window that took longer than the stutter threshold times the median
+		uint32_t stutterCount = 0;
+
+		// since the last Reset
+		uint64_t totalFrames = 0;
+		// frames that took longer than the stutter threshold times the moving average, since the last Reset
+		uint64_t totalStutterCount = 0;
+	};
+
+	// Fixed-size ring of per-frame times. Only one thread may add samples (the one calling Present),
+	// but any thread can ask for a summary or reset at any time. Nothing in here allocates or locks.
+	// A summary taken while samples are being added may mix in a frame or two from the next window.
+	class FrameTimeStatistics
+	{
+	public:
+		static constexpr uint32_t MaxSamples = 512;
+
+		FrameTimeStatistics();
+
+		void AddSample( double seconds );
+		// Safe from any thread: the samples are only cleared by the next AddSample,
+		// until then summaries come out empty
+		void Reset();
+
+		// Returns false if there are no samples yet
+		bool GetSummary( FrameTimeSummary& outSummary ) const;
+
+		// A frame counts as a stutter if it takes longer than this many times the typical frame time
+		void SetStutterThreshold( double ratio ) { m_StutterThreshold.store( ratio, std::memory_order_relaxed ); }
+		[[nodiscard]] double GetStutterThreshold() const { return m_StutterThreshold.load( std::memory_order_relaxed ); }
+
+	private:
+		std::array<std::atomic<float>, MaxSamples> m_Samples;
+		// number of samples ever added, the next one goes into m_Samples[m_NumSamples % MaxSamples]
+		std::atomic<uint64_t> m_NumSamples{ 0 };
+		std::atomic<uint64_t> m_TotalStutterCount{ 0 };
+		std::atomic<double> m_StutterThreshold{ 2.0 };
+		std::atomic<bool> m_ResetRequested{ false };
+
+		// only touched by the thread adding samples
+		double m_MovingAverage = 0.0;
+
+		// Does what Reset asks for, on the thread adding samples
+		void clearSamples();
+	};
+}
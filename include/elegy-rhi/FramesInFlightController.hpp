@@ -0,0 +1,48 @@
+// Picks how many frames the GPU may lag behind the CPU, see DeviceCreationParameters::adaptiveFramesInFlight
+
+#pragma once
+
+#include <cstdint>
+
+namespace nvrhi::app
+{
+	// Looks at windows of WindowFrames frames. More frames in flight only buy throughput when the CPU and
+	// the GPU take turns being the slow one: then the GPU runs dry on some frames while the CPU waits for it
+	// on others, and a deeper queue evens that out. Otherwise every extra frame is just latency, so the depth
+	// goes down one frame per window until the GPU starts running dry. Going back up makes the next step down
+	// wait for longer, so a workload sitting right at the edge doesn't keep flipping between two depths
+	class FramesInFlightController
+	{
+	public:
+		static constexpr uint32_t WindowFrames = 60;
+
+		// Starts at maxFrames, where frame pacing was before adaptive mode
+		void Reset( uint32_t minFrames, uint32_t maxFrames );
+
+		// frameTime is the CPU frame time and frameWaitTime how much of it was spent waiting for the GPU,
+		// both in seconds. framesQueued is how many frames the GPU hadn't finished yet right after this one
+		// was submitted, this one included, so 1 means the GPU had nothing else to do
+		void AddFrame( double frameTime, double frameWaitTime, uint64_t framesQueued );
+
+		[[nodiscard]] uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+
+	private:
+		void beginWindow();
+
+		uint32_t m_MinFrames = 1;
+		uint32_t m_MaxFrames = 1;
+		uint32_t m_FramesInFlight = 1;
+
+		uint32_t m_WindowFrameCount = 0;
+		// the CPU waited for the GPU for a noticeable part of the frame
+		uint32_t m_GpuBoundFrames = 0;
+		// the GPU had already finished everything before this frame when it was submitted
+		uint32_t m_StarvedFrames = 0;
+		double m_FrameTimeSum = 0.0;
+		double m_MaxFrameTime = 0.0;
+
+		// windows left until the depth may go down again, and how many to wait after the next raise
+		uint32_t m_HoldWindows = 0;
+		uint32_t m_Backoff = 1;
+	};
+}
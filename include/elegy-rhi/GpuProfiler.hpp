@@ -0,0 +1,120 @@
+// GPU timings of scoped zones on nvrhi command lists, built on nvrhi timer queries
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace nvrhi::app
+{
+	struct GpuZoneTiming
+	{
+		const char* name = nullptr;
+		// 0 for top-level zones
+		uint32_t depth = 0;
+		// index of the enclosing zone in GpuFrameTimings::zones, or GpuProfiler::NoParent
+		uint32_t parent = 0;
+		float milliseconds = 0.0f;
+	};
+
+	struct GpuFrameTimings
+	{
+		// see DeviceManager::GetCurrentFrameValue, 0 if nothing was resolved yet
+		uint64_t frameValue = 0;
+		// in the order the zones were opened, so parents always come before their children
+		std::vector<GpuZoneTiming> zones;
+	};
+
+	// Hands out timer zones for the frame being recorded and resolves them a few frames later,
+	// once the GPU is done with them. Results are never waited for: if a frame's queries still aren't
+	// ready by the time its slot comes around again, that frame is dropped.
+	// Zones are meant to be opened and closed from the thread that records and presents frames.
+	class GpuProfiler
+	{
+	public:
+		static constexpr uint32_t NoParent = ~0u;
+
+		// Keeps one set of queries per frame in flight, plus one for the frame being recorded
+		GpuProfiler( nvrhi::IDevice* device, uint32_t maxFramesInFlight );
+
+		// Zone names must outlive the profiler, string literals are the intended use
+		void BeginZone( nvrhi::ICommandList* commandList, const char* name );
+		void EndZone( nvrhi::ICommandList* commandList );
+
+		// Called by the DeviceManager once a frame has been submitted. completedFrameValue is the last
+		// frame the GPU has finished, or 0 if the backend doesn't know, in which case queries are just polled
+		void EndFrame( uint64_t frameValue, uint64_t completedFrameValue );
+
+		// The most recent frame that got resolved
+		[[nodiscard]] const GpuFrameTimings& GetLatestTimings() const { return m_LatestTimings; }
+		// Frames whose results weren't ready in time
+		[[nodiscard]] uint64_t GetDroppedFrameCount() const { return m_DroppedFrameCount; }
+		// Timer queries created so far, they are recycled so this levels off at the most zones in flight
+		[[nodiscard]] uint32_t GetQueryCount() const { return m_QueryCount; }
+
+	private:
+		struct PendingZone
+		{
+			const char* name = nullptr;
+			uint32_t depth = 0;
+			uint32_t parent = NoParent;
+			nvrhi::TimerQueryHandle query;
+		};
+
+		struct FrameSlot
+		{
+			uint64_t frameValue = 0;
+			bool pending = false;
+			std::vector<PendingZone> zones;
+		};
+
+		bool tryResolve( FrameSlot& slot, uint64_t completedFrameValue );
+		void dropSlot( FrameSlot& slot );
+		void reclaimDroppedQueries();
+		nvrhi::TimerQueryHandle allocateQuery();
+
+		nvrhi::DeviceHandle m_Device;
+
+		std::vector<FrameSlot> m_Slots;
+		uint32_t m_CurrentSlot = 0;
+		// frame counter for backends that don't report frame values
+		uint64_t m_FrameCounter = 0;
+
+		// indices of the open zones in the current slot
+		std::vector<uint32_t> m_ZoneStack;
+		std::vector<nvrhi::TimerQueryHandle> m_FreeQueries;
+		// from dropped frames, they go back to m_FreeQueries once the GPU is done writing them
+		std::vector<nvrhi::TimerQueryHandle> m_DroppedQueries;
+
+		GpuFrameTimings m_LatestTimings;
+		uint64_t m_DroppedFrameCount = 0;
+		uint32_t m_QueryCount = 0;
+	};
+
+	// Opens a zone for its lifetime, does nothing if the profiler is null (i.e. profiling is off)
+	class GpuProfilerZone
+	{
+	public:
+		GpuProfilerZone( GpuProfiler* profiler, nvrhi::ICommandList* commandList, const char* name )
+			: m_Profiler( profiler ), m_CommandList( commandList )
+		{
+			if ( m_Profiler )
+				m_Profiler->BeginZone( m_CommandList, name );
+		}
+
+		~GpuProfilerZone()
+		{
+			if ( m_Profiler )
+				m_Profiler->EndZone( m_CommandList );
+		}
+
+		GpuProfilerZone( const GpuProfilerZone& ) = delete;
+		GpuProfilerZone& operator=( const GpuProfilerZone& ) = delete;
+
+	private:
+		GpuProfiler* m_Profiler;
+		nvrhi::ICommandList* m_CommandList;
+	};
+}
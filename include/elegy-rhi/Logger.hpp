@@ -0,0 +1,258 @@
+// Asynchronous logging for the DeviceManager: messages are captured as a format string plus its
+// arguments, and only formatted on a background thread right before they go to the IMessageCallback
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+namespace nvrhi::app
+{
+	// Queues messages from any number of threads into a lock-free ring, a consumer thread formats them
+	// printf-style and hands them to the callback. Logging costs a slot claim and a few copies, no formatting.
+	// Integer arguments are widened to 64 bits, so length modifiers like %zu or %lld are optional and ignored.
+	// Errors and fatal errors are delivered before Log returns, and wait for room when the queue is full,
+	// anything less severe is counted and reported later instead of blocking the caller.
+	// The callback is only ever called from the logging thread, which starts with the first message
+	class Logger
+	{
+	public:
+		// must be a power of two
+		static constexpr uint32_t QueueSize = 512;
+		static constexpr uint32_t MaxArguments = 8;
+		// strings that don't fit in here go to the heap
+		static constexpr uint32_t InlineStringBytes = 320;
+
+		Logger();
+		~Logger();
+
+		Logger( const Logger& ) = delete;
+		Logger& operator=( const Logger& ) = delete;
+
+		// format has to stay valid until the message is delivered, string literals are the idea.
+		// String arguments (const char*, std::string, std::string_view) are copied
+		template<typename... Args>
+		void Log( nvrhi::IMessageCallback* callback, nvrhi::MessageSeverity severity, const char* format, const Args&... args )
+		{
+			static_assert( sizeof...( Args ) <= MaxArguments, "Too many arguments for a log message" );
+
+			if ( nullptr == callback )
+				return;
+
+			Cell* cell = claimCell();
+			if ( nullptr == cell )
+			{
+				if ( severity < nvrhi::MessageSeverity::Error )
+				{
+					dropMessage();
+					return;
+				}
+
+				// The callback itself logging an error: no cell frees up until it returns,
+				// and this is the logging thread anyway
+				if ( isLoggingThread() )
+				{
+					Record record;
+					record.Begin( callback, severity, format );
+					(record.Capture( args ), ...);
+					std::string text;
+					deliver( record, text );
+					return;
+				}
+
+				// better slow than lost
+				cell = waitForCell();
+			}
+
+			cell->record.Begin( callback, severity, format );
+			(cell->record.Capture( args ), ...);
+			publishCell( cell );
+
+			if ( severity >= nvrhi::MessageSeverity::Error )
+			{
+				Flush();
+			}
+		}
+
+		// For messages that are already formatted, the text is copied
+		void LogText( nvrhi::IMessageCallback* callback, nvrhi::MessageSeverity severity, const char* text )
+		{
+			Log( callback, severity, "%s", text );
+		}
+
+		// Blocks until everything logged before the call has been delivered.
+		// Does nothing when called from the callback, which runs on the logging thread
+		void Flush();
+
+		// Messages lost to a full queue so far
+		[[nodiscard]] uint64_t GetDroppedCount() const { return m_DroppedMessages.load( std::memory_order_relaxed ); }
+
+	private:
+		struct Argument
+		{
+			enum Type : uint8_t
+			{
+				Signed,
+				Unsigned,
+				Double,
+				Pointer,
+				String
+			};
+
+			union
+			{
+				int64_t i;
+				uint64_t u;
+				double d;
+				const void* p;
+				const char* s;
+			};
+			uint32_t length;
+			Type type;
+			// s points to a heap copy that the logging thread deletes
+			bool owned;
+		};
+
+		struct Record
+		{
+			nvrhi::IMessageCallback* callback;
+			const char* format;
+			nvrhi::MessageSeverity severity;
+			uint32_t numArguments;
+			uint32_t stringBytes;
+			Argument arguments[MaxArguments];
+			char strings[InlineStringBytes];
+
+			void Begin( nvrhi::IMessageCallback* inCallback, nvrhi::MessageSeverity inSeverity, const char* inFormat )
+			{
+				callback = inCallback;
+				severity = inSeverity;
+				format = inFormat;
+				numArguments = 0;
+				stringBytes = 0;
+			}
+
+			template<typename T>
+			void Capture( const T& value )
+			{
+				using Decayed = std::decay_t<T>;
+				Argument& argument = arguments[numArguments++];
+				argument.owned = false;
+
+				if constexpr ( std::is_same_v<Decayed, const char*> || std::is_same_v<Decayed, char*> )
+				{
+					captureString( argument, (nullptr == value) ? std::string_view( "(null)" ) : std::string_view( value ) );
+				}
+				else if constexpr ( std::is_convertible_v<const T&, std::string_view> )
+				{
+					captureString( argument, std::string_view( value ) );
+				}
+				else if constexpr ( std::is_enum_v<T> )
+				{
+					argument.type = std::is_signed_v<std::underlying_type_t<T>> ? Argument::Signed : Argument::Unsigned;
+					argument.i = int64_t( value );
+				}
+				else if constexpr ( std::is_same_v<T, bool> || (std::is_integral_v<T> && std::is_unsigned_v<T>) )
+				{
+					argument.type = Argument::Unsigned;
+					argument.u = uint64_t( value );
+				}
+				else if constexpr ( std::is_integral_v<T> )
+				{
+					argument.type = Argument::Signed;
+					argument.i = int64_t( value );
+				}
+				else if constexpr ( std::is_floating_point_v<T> )
+				{
+					argument.type = Argument::Double;
+					argument.d = double( value );
+				}
+				else
+				{
+					static_assert( std::is_pointer_v<T>, "Unsupported log argument type" );
+					argument.type = Argument::Pointer;
+					argument.p = static_cast<const void*>( value );
+				}
+			}
+
+			void captureString( Argument& argument, std::string_view string )
+			{
+				argument.type = Argument::String;
+				argument.length = uint32_t( string.size() );
+
+				if ( string.size() <= InlineStringBytes - stringBytes )
+				{
+					std::memcpy( strings + stringBytes, string.data(), string.size() );
+					argument.s = strings + stringBytes;
+					stringBytes += uint32_t( string.size() );
+				}
+				else
+				{
+					char* copy = new char[string.size()];
+					std::memcpy( copy, string.data(), string.size() );
+					argument.s = copy;
+					argument.owned = true;
+				}
+			}
+		};
+
+		// Slot of the bounded MPMC queue by Dmitry Vyukov: sequence == position means free for the producer
+		// claiming that position, position + 1 means published and ready for the consumer
+		struct alignas( 64 ) Cell
+		{
+			std::atomic<uint64_t> sequence;
+			Record record;
+		};
+
+		// Starts the logging thread if it isn't running yet
+		Cell* claimCell();
+		// For messages that can't be dropped, spins until the logging thread frees a cell
+		Cell* waitForCell();
+		void publishCell( Cell* cell );
+		// Counts a message lost to a full queue, the logging thread reports it
+		void dropMessage();
+		// Wakes the logging thread if it's waiting for something to do
+		void wakeConsumer();
+		// Whether the logging thread has anything to do, see threadMain
+		[[nodiscard]] bool hasWork() const;
+		// Delivers everything published so far, returns false if there was nothing
+		bool consume();
+		// Formats into buffer and calls the callback
+		void deliver( Record& record, std::string& buffer );
+		void startThread();
+		[[nodiscard]] bool isLoggingThread() const;
+		void threadMain();
+
+		std::unique_ptr<Cell[]> m_Cells;
+		alignas( 64 ) std::atomic<uint64_t> m_EnqueuePosition{ 0 };
+		alignas( 64 ) std::atomic<uint64_t> m_DequeuePosition{ 0 };
+		std::atomic<uint64_t> m_DroppedMessages{ 0 };
+
+		std::mutex m_Mutex;
+		// the logging thread waits on this when the queue is empty
+		std::condition_variable m_WakeCondition;
+		// and signals this after delivering, for Flush
+		std::condition_variable m_DeliveredCondition;
+		std::atomic<bool> m_ConsumerSleeping{ false };
+		bool m_Stop = false;
+
+		// only touched by the logging thread
+		uint64_t m_ReportedDroppedMessages = 0;
+		nvrhi::IMessageCallback* m_LastCallback = nullptr;
+		std::string m_FormatBuffer;
+
+		std::once_flag m_ThreadStartFlag;
+		std::atomic<bool> m_ThreadStarted{ false };
+		std::thread m_Thread;
+	};
+}
@@ -0,0 +1,75 @@
+// CPU timeline markers, exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) or as a Perfetto trace.
+// Only compiled in with the ELR_ENABLE_TRACE CMake option, otherwise ELR_TRACE_SCOPE is nothing at all
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifndef ELR_ENABLE_TRACE
+#define ELR_ENABLE_TRACE 0
+#endif
+
+#define ELR_TRACE_CONCAT_INNER( a, b ) a##b
+#define ELR_TRACE_CONCAT( a, b ) ELR_TRACE_CONCAT_INNER( a, b )
+
+#if ELR_ENABLE_TRACE
+// Times the rest of the enclosing scope. The name has to be a string literal, only the pointer is kept
+#define ELR_TRACE_SCOPE( name ) const ::nvrhi::app::TraceScope ELR_TRACE_CONCAT( elrTraceScope, __LINE__ )( name )
+#else
+#define ELR_TRACE_SCOPE( name ) do {} while ( false )
+#endif
+
+namespace nvrhi::app
+{
+	// Every thread that records markers gets its own ring of the last EventsPerThread markers, nothing is shared
+	// or locked while recording. Export while markers are being recorded may tear the few events being overwritten.
+	// Without ELR_ENABLE_TRACE all of these do nothing and the exports fail
+	class Trace
+	{
+	public:
+		// must be a power of two
+		static constexpr uint32_t EventsPerThread = 16384;
+
+		static constexpr bool IsEnabled() { return ELR_ENABLE_TRACE != 0; }
+
+		// Shows up as the track name, the name is copied
+		static void SetThreadName( const char* name );
+		static void Clear();
+
+		// For scopes that don't fit ELR_TRACE_SCOPE, timestamps come from Now
+		static void Record( const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds );
+
+		// chrome://tracing JSON, "X" events in microseconds
+		static bool WriteChromeJson( const std::string& path );
+		// Perfetto protobuf, TrackEvent slices on one track per thread
+		static bool WritePerfetto( const std::string& path );
+
+		static uint64_t Now()
+		{
+			return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+		}
+	};
+
+	class TraceScope
+	{
+	public:
+		explicit TraceScope( const char* name )
+			: m_Name( name ), m_Begin( Trace::Now() )
+		{
+		}
+
+		~TraceScope()
+		{
+			Trace::Record( m_Name, m_Begin, Trace::Now() );
+		}
+
+		TraceScope( const TraceScope& ) = delete;
+		TraceScope& operator=( const TraceScope& ) = delete;
+
+	private:
+		const char* m_Name;
+		uint64_t m_Begin;
+	};
+}
@@ -0,0 +1,111 @@
+// Vulkan extensions the DeviceManager knows about, for cheap typed queries like
+// DeviceManager::IsVulkanDeviceExtensionEnabled( VulkanDeviceExtensions::RayQuery ).
+// Doesn't need the Vulkan headers, the names are spelled out here
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace nvrhi::app
+{
+	struct VulkanInstanceExtensions
+	{
+		enum Type : uint32_t
+		{
+			GetPhysicalDeviceProperties2 = 0,
+			GetSurfaceCapabilities2,
+			Surface,
+			SurfaceMaintenance1,
+			Win32Surface,
+			XlibSurface,
+			WaylandSurface,
+			DebugReport,
+			DebugUtils,
+
+			Count
+		};
+
+		static constexpr const char* Names[Count] =
+		{
+			"VK_KHR_get_physical_device_properties2",
+			"VK_KHR_get_surface_capabilities2",
+			"VK_KHR_surface",
+			"VK_EXT_surface_maintenance1",
+			"VK_KHR_win32_surface",
+			"VK_KHR_xlib_surface",
+			"VK_KHR_wayland_surface",
+			"VK_EXT_debug_report",
+			"VK_EXT_debug_utils",
+		};
+
+		// Returns Count for extensions that aren't in the list
+		static constexpr Type Find( std::string_view name )
+		{
+			for ( uint32_t i = 0; i < Count; i++ )
+			{
+				if ( name == Names[i] )
+					return Type( i );
+			}
+
+			return Count;
+		}
+	};
+
+	struct VulkanDeviceExtensions
+	{
+		enum Type : uint32_t
+		{
+			Swapchain = 0,
+			Maintenance1,
+			SwapchainMaintenance1,
+			PresentId,
+			PresentWait,
+			DebugMarker,
+			DescriptorIndexing,
+			BufferDeviceAddress,
+			MeshShaderNV,
+			FragmentShadingRate,
+			AccelerationStructure,
+			DeferredHostOperations,
+			PipelineLibrary,
+			RayQuery,
+			RayTracingPipeline,
+			DynamicRendering,
+
+			Count
+		};
+
+		static constexpr const char* Names[Count] =
+		{
+			"VK_KHR_swapchain",
+			"VK_KHR_maintenance1",
+			"VK_EXT_swapchain_maintenance1",
+			"VK_KHR_present_id",
+			"VK_KHR_present_wait",
+			"VK_EXT_debug_marker",
+			"VK_EXT_descriptor_indexing",
+			"VK_KHR_buffer_device_address",
+			"VK_NV_mesh_shader",
+			"VK_KHR_fragment_shading_rate",
+			"VK_KHR_acceleration_structure",
+			"VK_KHR_deferred_host_operations",
+			"VK_KHR_pipeline_library",
+			"VK_KHR_ray_query",
+			"VK_KHR_ray_tracing_pipeline",
+			"VK_KHR_dynamic_rendering",
+		};
+
+		// Returns Count for extensions that aren't in the list
+		static constexpr Type Find( std::string_view name )
+		{
+			for ( uint32_t i = 0; i < Count; i++ )
+			{
+				if ( name == Names[i] )
+					return Type( i );
+			}
+
+			return Count;
+		}
+	};
+}
@@ -0,0 +1,69 @@
+#include "elegy-rhi/BlockingTimeStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace nvrhi::app;
+
+void BlockingTimeHistogram::AddSample( uint64_t nanoseconds )
+{
+	// bucket i > 0 starts at 2^(i-1) microseconds, which is where the highest set bit of the microseconds lands
+	uint64_t microseconds = nanoseconds / 1000;
+	uint32_t bucket = 0;
+	while ( microseconds > 0 && bucket < NumBuckets - 1 )
+	{
+		microseconds >>= 1;
+		bucket++;
+	}
+
+	m_Buckets[bucket].fetch_add( 1, std::memory_order_relaxed );
+	m_TotalCount.fetch_add( 1, std::memory_order_relaxed );
+	m_TotalNanoseconds.fetch_add( nanoseconds, std::memory_order_relaxed );
+
+	// only one thread adds samples, so no compare-exchange loop needed
+	if ( nanoseconds > m_MaxNanoseconds.load( std::memory_order_relaxed ) )
+	{
+		m_MaxNanoseconds.store( nanoseconds, std::memory_order_relaxed );
+	}
+}
+
+void BlockingTimeHistogram::Reset()
+{
+	for ( auto& bucket : m_Buckets )
+	{
+		bucket.store( 0, std::memory_order_relaxed );
+	}
+
+	m_TotalCount.store( 0, std::memory_order_relaxed );
+	m_TotalNanoseconds.store( 0, std::memory_order_relaxed );
+	m_MaxNanoseconds.store( 0, std::memory_order_relaxed );
+}
+
+double BlockingTimeHistogram::GetBucketUpperBound( uint32_t bucket ) const
+{
+	if ( bucket >= NumBuckets - 1 )
+		return GetMaxSeconds();
+
+	return std::ldexp( 1e-6, int( bucket ) );
+}
+
+double BlockingTimeHistogram::GetPercentile( double fraction ) const
+{
+	const uint64_t totalCount = GetTotalCount();
+	if ( totalCount == 0 )
+		return 0.0;
+
+	// nearest rank, same as FrameTimeStatistics
+	const uint64_t rank = std::max<uint64_t>( 1, uint64_t( std::ceil( std::clamp( fraction, 0.0, 1.0 ) * double( totalCount ) ) ) );
+
+	uint64_t count = 0;
+	for ( uint32_t bucket = 0; bucket < NumBuckets; bucket++ )
+	{
+		count += GetBucketCount( bucket );
+		if ( count >= rank )
+			return std::min( GetBucketUpperBound( bucket ), GetMaxSeconds() );
+	}
+
+	// samples were added while counting
+	return GetMaxSeconds();
+}
@@ -1,181 +1,369 @@
-/*
-* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
-*
-* Permission is hereby granted, free of charge, to any person obtaining a
-* copy of this software and associated documentation files (the "Software"),
-* to deal in the Software without restriction, including without limitation
-* the rights to use, copy, modify, merge, publish, distribute, sublicense,
-* and/or sell copies of the Software, and to permit persons to whom the
-* Software is furnished to do so, subject to the following conditions:
-*
-* The above copyright notice and this permission notice shall be included in
-* all copies or substantial portions of the Software.
-*
-* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
-* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
-* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
-* DEALINGS IN THE SOFTWARE.
-*/
-
-// Adapted from Donut's DeviceManager
-// https://github.com/NVIDIAGameWorks/donut/blob/main/src/app/DeviceManager.cpp
-
-#include "elegy-rhi/DeviceManager.hpp"
-#include <nvrhi/utils.h>
-#include <iostream>
-
-using namespace std::string_literals;
-using namespace nvrhi::app;
-
-bool DeviceManager::CreateWindowDeviceAndSwapChain( const DeviceCreationParameters& params )
-{
-	this->m_DeviceParams = params;
-	m_RequestedVSync = params.vsyncEnabled;
-
-	if ( !CreateDeviceAndSwapChain() )
-		return false;
-
-	// reset the back buffer size state to enforce a resize event
-	m_DeviceParams.backBufferWidth = 0;
-	m_DeviceParams.backBufferHeight = 0;
-
-	UpdateWindowSize( params.backBufferWidth, params.backBufferHeight );
-
-	return true;
-}
-
-void DeviceManager::BackBufferResizing()
-{
-	m_SwapChainFramebuffers.clear();
-}
-
-void DeviceManager::BackBufferResized()
-{
-	uint32_t backBufferCount = GetBackBufferCount();
-	m_SwapChainFramebuffers.resize( backBufferCount );
-	for ( uint32_t index = 0; index < backBufferCount; index++ )
-	{
-		m_SwapChainFramebuffers[index] = GetDevice()->createFramebuffer(
-			nvrhi::FramebufferDesc().addColorAttachment( GetBackBuffer( index ) ) );
-	}
-}
-
-void DeviceManager::GetWindowDimensions( int& width, int& height )
-{
-	width = m_DeviceParams.backBufferWidth;
-	height = m_DeviceParams.backBufferHeight;
-}
-
-void DeviceManager::Message( const char* message, nvrhi::MessageSeverity severity )
-{
-	if ( nullptr != m_DeviceParams.messageCallback )
-	{
-		auto*& printer = m_DeviceParams.messageCallback;
-		printer->message( severity, message );
-	}
-}
-
-void DeviceManager::Error( const char* message )
-{
-	return Message( message, nvrhi::MessageSeverity::Error );
-}
-
-void DeviceManager::Fatal( const char* message )
-{
-	return Message( message, nvrhi::MessageSeverity::Fatal );
-}
-
-const DeviceCreationParameters& DeviceManager::GetDeviceParams()
-{
-	return m_DeviceParams;
-}
-
-void DeviceManager::UpdateWindowSize( int width, int height )
-{
-	if ( width == 0 || height == 0 )
-	{
-		// window is minimized
-		m_windowVisible = false;
-		return;
-	}
-
-	m_windowVisible = true;
-
-	if ( int( m_DeviceParams.backBufferWidth ) != width ||
-		int( m_DeviceParams.backBufferHeight ) != height ||
-		(m_DeviceParams.vsyncEnabled != m_RequestedVSync && GetGraphicsAPI() == nvrhi::GraphicsAPI::VULKAN) )
-	{
-		// window is not minimized, and the size has changed
-
-		BackBufferResizing();
-
-		m_DeviceParams.backBufferWidth = width;
-		m_DeviceParams.backBufferHeight = height;
-		m_DeviceParams.vsyncEnabled = m_RequestedVSync;
-
-		ResizeSwapChain();
-		BackBufferResized();
-	}
-
-	m_DeviceParams.vsyncEnabled = m_RequestedVSync;
-}
-
-void DeviceManager::Shutdown()
-{
-	m_SwapChainFramebuffers.clear();
-
-	DestroyDeviceAndSwapChain();
-}
-
-nvrhi::IFramebuffer* nvrhi::app::DeviceManager::GetCurrentFramebuffer()
-{
-	return GetFramebuffer( GetCurrentBackBufferIndex() );
-}
-
-nvrhi::IFramebuffer* nvrhi::app::DeviceManager::GetFramebuffer( uint32_t index )
-{
-	if ( index < m_SwapChainFramebuffers.size() )
-		return m_SwapChainFramebuffers[index];
-
-	return nullptr;
-}
-
-namespace std
-{
-	std::string to_string( nvrhi::GraphicsAPI api )
-	{
-		switch ( api )
-		{
-		case nvrhi::GraphicsAPI::D3D11: return "D3D11";
-		case nvrhi::GraphicsAPI::D3D12: return "D3D12";
-		case nvrhi::GraphicsAPI::VULKAN: return "VULKAN";
-		}
-
-		return "unknown";
-	}
-}
-
-nvrhi::app::DeviceManager* nvrhi::app::DeviceManager::Create( nvrhi::GraphicsAPI api )
-{
-	switch ( api )
-	{
-#if USE_DX11
-	case nvrhi::GraphicsAPI::D3D11:
-		return CreateD3D11();
-#endif
-#if USE_DX12
-	case nvrhi::GraphicsAPI::D3D12:
-		return CreateD3D12();
-#endif
-#if USE_VK
-	case nvrhi::GraphicsAPI::VULKAN:
-		return CreateVK();
-#endif
-	default:
-		std::cout << "DeviceManager::Create: Unsupported graphics API: " << std::to_string( api ) << std::endl;
-		return nullptr;
-	}
-}
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+// Adapted from Donut's DeviceManager
+// https://github.com/NVIDIAGameWorks/donut/blob/main/src/app/DeviceManager.cpp
+
+#include "elegy-rhi/DeviceManager.hpp"
+#include <nvrhi/utils.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace std::string_literals;
+using namespace nvrhi::app;
+
+bool DeviceManager::CreateWindowDeviceAndSwapChain( const DeviceCreationParameters& params )
+{
+	this->m_DeviceParams = params;
+	m_RequestedVSync = params.vsyncEnabled;
+
+	if ( !CreateDeviceAndSwapChain() )
+		return false;
+
+	DeviceCreated();
+	SwapChainCreated( params.backBufferWidth, params.backBufferHeight );
+
+	return true;
+}
+
+bool DeviceManager::CreateDevice( const DeviceCreationParameters& params )
+{
+	this->m_DeviceParams = params;
+	m_RequestedVSync = params.vsyncEnabled;
+
+	if ( !CreateDeviceOnly() )
+		return false;
+
+	DeviceCreated();
+
+	// headless mode has its back buffers already
+	if ( params.headless )
+	{
+		SwapChainCreated( params.backBufferWidth, params.backBufferHeight );
+	}
+
+	return true;
+}
+
+bool DeviceManager::AttachWindowSurface( const WindowSurfaceData& surfaceData, int width, int height )
+{
+	m_DeviceParams.windowSurfaceData = surfaceData;
+	m_DeviceParams.backBufferWidth = width;
+	m_DeviceParams.backBufferHeight = height;
+
+	if ( !CreateWindowSurfaceAndSwapChain() )
+		return false;
+
+	SwapChainCreated( width, height );
+
+	return true;
+}
+
+void DeviceManager::DeviceCreated()
+{
+	m_DynamicRenderingEnabled = m_DeviceParams.enableDynamicRendering && m_DeviceCapabilities.dynamicRendering;
+	m_FramesInFlightController.Reset( m_DeviceParams.minFramesInFlight, m_DeviceParams.maxFramesInFlight );
+
+	// the null backend has no device to run queries on
+	if ( m_DeviceParams.enableGpuProfiler && GetDevice() )
+	{
+		m_GpuProfiler = std::make_unique<GpuProfiler>( GetDevice(), m_DeviceParams.maxFramesInFlight );
+	}
+}
+
+void DeviceManager::SwapChainCreated( int width, int height )
+{
+	// reset the back buffer size state to enforce a resize event
+	m_DeviceParams.backBufferWidth = 0;
+	m_DeviceParams.backBufferHeight = 0;
+
+	UpdateWindowSize( width, height );
+}
+
+bool DeviceManager::CreateDeviceOnly()
+{
+	Error( "Creating the device without a window surface isn't supported by this backend" );
+	return false;
+}
+
+bool DeviceManager::CreateWindowSurfaceAndSwapChain()
+{
+	Error( "Attaching a window surface isn't supported by this backend" );
+	return false;
+}
+
+void DeviceManager::BackBufferResizing()
+{
+	m_SwapChainFramebuffers.clear();
+}
+
+void DeviceManager::BackBufferResized()
+{
+	// no device and no back buffers on the null backend
+	if ( !GetDevice() )
+		return;
+
+	uint32_t backBufferCount = GetBackBufferCount();
+	m_SwapChainFramebuffers.resize( backBufferCount );
+
+	// dynamic rendering draws to the back buffers directly, GetFramebuffer makes them if anyone still wants them
+	if ( m_DynamicRenderingEnabled )
+		return;
+
+	for ( uint32_t index = 0; index < backBufferCount; index++ )
+	{
+		m_SwapChainFramebuffers[index] = GetDevice()->createFramebuffer(
+			nvrhi::FramebufferDesc().addColorAttachment( GetBackBuffer( index ) ) );
+	}
+}
+
+void DeviceManager::UpdateFrameTime()
+{
+	const double now = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+
+	m_FrameBlockingTimes.frameIndex = m_FrameIndex;
+	m_FrameBlockingTimes.frameTime = 0.0;
+
+	// the very first frame has nothing to compare against
+	if ( m_PreviousFrameTimestamp > 0.0 )
+	{
+		const double elapsedTime = now - m_PreviousFrameTimestamp;
+		m_FrameBlockingTimes.frameTime = elapsedTime;
+
+		m_FrameTimeStatistics.AddSample( elapsedTime );
+
+		if ( m_DeviceParams.adaptiveFramesInFlight )
+		{
+			m_FramesInFlightController.AddFrame( elapsedTime, m_FrameBlockingTimes.seconds[BlockingCalls::FrameWait], m_FramesQueuedAtSubmit );
+		}
+
+		m_FrameTimeSum += elapsedTime;
+		m_NumberOfAccumulatedFrames += 1;
+
+		if ( m_FrameTimeSum > m_AverageTimeUpdateInterval && m_NumberOfAccumulatedFrames > 0 )
+		{
+			m_AverageFrameTime = m_FrameTimeSum / double( m_NumberOfAccumulatedFrames );
+			m_NumberOfAccumulatedFrames = 0;
+			m_FrameTimeSum = 0.0;
+		}
+	}
+
+	if ( nullptr != m_DeviceParams.blockingTimeCallback )
+	{
+		m_DeviceParams.blockingTimeCallback->OnFrameBlockingTimes( m_FrameBlockingTimes );
+	}
+	m_FrameBlockingTimes = FrameBlockingTimes();
+
+	m_PreviousFrameTimestamp = now;
+	m_FrameIndex++;
+
+	const uint32_t reportInterval = m_DeviceParams.validationReportSampleInterval;
+	const bool reportRequested = m_ValidationReportFrameRequested.exchange( false, std::memory_order_relaxed );
+	m_ValidationReportFrame.store( reportInterval <= 1 || reportRequested || m_FrameIndex % reportInterval == 0,
+		std::memory_order_relaxed );
+
+	if ( m_GpuProfiler )
+	{
+		m_GpuProfiler->EndFrame( GetCurrentFrameValue(), GetCompletedFrameValue() );
+	}
+}
+
+void DeviceManager::RecordBlockingTime( BlockingCalls::Type call, uint64_t nanoseconds )
+{
+	m_BlockingTimeHistograms[call].AddSample( nanoseconds );
+	m_FrameBlockingTimes.seconds[call] += double( nanoseconds ) * 1e-9;
+}
+
+uint64_t DeviceManager::PrepareFrameWait()
+{
+	const uint64_t frameValue = GetCurrentFrameValue();
+	m_FramesQueuedAtSubmit = frameValue - std::min( GetCompletedFrameValue(), frameValue );
+
+	const uint32_t framesInFlight = GetFramesInFlight();
+	return (frameValue > framesInFlight) ? frameValue - framesInFlight : 0;
+}
+
+uint32_t DeviceManager::GetFramesInFlight() const
+{
+	return m_DeviceParams.adaptiveFramesInFlight ? m_FramesInFlightController.GetFramesInFlight() : m_DeviceParams.maxFramesInFlight;
+}
+
+void DeviceManager::SetAdaptiveFramesInFlight( bool enabled )
+{
+	m_DeviceParams.adaptiveFramesInFlight = enabled;
+	m_FramesInFlightController.Reset( m_DeviceParams.minFramesInFlight, m_DeviceParams.maxFramesInFlight );
+}
+
+void DeviceManager::ResetBlockingTimeHistograms()
+{
+	for ( BlockingTimeHistogram& histogram : m_BlockingTimeHistograms )
+	{
+		histogram.Reset();
+	}
+}
+
+void DeviceManager::GetWindowDimensions( int& width, int& height )
+{
+	width = m_DeviceParams.backBufferWidth;
+	height = m_DeviceParams.backBufferHeight;
+}
+
+void DeviceManager::Message( const char* message, nvrhi::MessageSeverity severity )
+{
+	if ( severity >= m_DeviceParams.minLogSeverity )
+	{
+		m_Logger.LogText( m_DeviceParams.messageCallback, severity, message );
+	}
+}
+
+void DeviceManager::SampledMessageCallback::message( nvrhi::MessageSeverity severity, const char* messageText )
+{
+	// errors are never sampled away, they may not even come from validation (e.g. failing to create a resource)
+	if ( m_Manager.IsValidationReportFrame() || severity >= nvrhi::MessageSeverity::Error )
+	{
+		m_Manager.Message( messageText, severity );
+	}
+}
+
+nvrhi::IMessageCallback* DeviceManager::GetNvrhiMessageCallback()
+{
+	if ( nullptr == m_DeviceParams.messageCallback )
+		return nullptr;
+
+	if ( m_DeviceParams.enableNvrhiValidationLayer && m_DeviceParams.validationReportSampleInterval > 1 )
+		return &m_SampledMessageCallback;
+
+	return m_DeviceParams.messageCallback;
+}
+
+void DeviceManager::Error( const char* message )
+{
+	return Message( message, nvrhi::MessageSeverity::Error );
+}
+
+void DeviceManager::Fatal( const char* message )
+{
+	return Message( message, nvrhi::MessageSeverity::Fatal );
+}
+
+const DeviceCreationParameters& DeviceManager::GetDeviceParams()
+{
+	return m_DeviceParams;
+}
+
+void DeviceManager::UpdateWindowSize( int width, int height )
+{
+	if ( width == 0 || height == 0 )
+	{
+		// window is minimized
+		m_windowVisible = false;
+		return;
+	}
+
+	m_windowVisible = true;
+
+	if ( int( m_DeviceParams.backBufferWidth ) != width ||
+		int( m_DeviceParams.backBufferHeight ) != height ||
+		(m_DeviceParams.vsyncEnabled != m_RequestedVSync && VSyncChangeRequiresResize( m_RequestedVSync )) )
+	{
+		// window is not minimized, and the size has changed
+
+		BackBufferResizing();
+
+		m_DeviceParams.backBufferWidth = width;
+		m_DeviceParams.backBufferHeight = height;
+		m_DeviceParams.vsyncEnabled = m_RequestedVSync;
+
+		ResizeSwapChain();
+		BackBufferResized();
+	}
+
+	m_DeviceParams.vsyncEnabled = m_RequestedVSync;
+}
+
+void DeviceManager::Shutdown()
+{
+	m_SwapChainFramebuffers.clear();
+	m_GpuProfiler.reset();
+
+	DestroyDeviceAndSwapChain();
+
+	// the message callback may well go away after this
+	m_Logger.Flush();
+}
+
+nvrhi::IFramebuffer* nvrhi::app::DeviceManager::GetCurrentFramebuffer()
+{
+	return GetFramebuffer( GetCurrentBackBufferIndex() );
+}
+
+nvrhi::IFramebuffer* nvrhi::app::DeviceManager::GetFramebuffer( uint32_t index )
+{
+	if ( index >= m_SwapChainFramebuffers.size() )
+		return nullptr;
+
+	if ( !m_SwapChainFramebuffers[index] && GetDevice() )
+	{
+		m_SwapChainFramebuffers[index] = GetDevice()->createFramebuffer(
+			nvrhi::FramebufferDesc().addColorAttachment( GetBackBuffer( index ) ) );
+	}
+
+	return m_SwapChainFramebuffers[index];
+}
+
+namespace std
+{
+	std::string to_string( nvrhi::GraphicsAPI api )
+	{
+		switch ( api )
+		{
+		case nvrhi::GraphicsAPI::D3D11: return "D3D11";
+		case nvrhi::GraphicsAPI::D3D12: return "D3D12";
+		case nvrhi::GraphicsAPI::VULKAN: return "VULKAN";
+		}
+
+		return "unknown";
+	}
+}
+
+nvrhi::app::DeviceManager* nvrhi::app::DeviceManager::Create( nvrhi::GraphicsAPI api )
+{
+	switch ( api )
+	{
+#if USE_DX11
+	case nvrhi::GraphicsAPI::D3D11:
+		return CreateD3D11();
+#endif
+#if USE_DX12
+	case nvrhi::GraphicsAPI::D3D12:
+		return CreateD3D12();
+#endif
+#if USE_VK
+	case nvrhi::GraphicsAPI::VULKAN:
+		return CreateVK();
+#endif
+	default:
+		std::cout << "DeviceManager::Create: Unsupported graphics API: " << std::to_string( api ) << std::endl;
+		return nullptr;
+	}
+}
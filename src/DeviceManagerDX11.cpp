@@ -246,6 +246,12 @@ void DeviceManager_DX11::ReportLiveObjects()
 
 bool DeviceManager_DX11::CreateDeviceAndSwapChain()
 {
+	if ( m_DeviceParams.headless )
+	{
+		Error( "Headless mode is only supported on Vulkan" );
+		return false;
+	}
+
 	UINT windowStyle = m_DeviceParams.startFullscreen
 		? (WS_POPUP | WS_SYSMENU | WS_VISIBLE)
 		: m_DeviceParams.startMaximized
@@ -360,7 +366,7 @@ bool DeviceManager_DX11::CreateDeviceAndSwapChain()
 
 	nvrhi::d3d11::DeviceDesc deviceDesc;
 	//deviceDesc.messageCallback = &DefaultMessageCallback::GetInstance();
-	deviceDesc.messageCallback = m_DeviceParams.messageCallback;
+	deviceDesc.messageCallback = GetNvrhiMessageCallback();
 	deviceDesc.context = m_ImmediateContext;
 
 	m_NvrhiDevice = nvrhi::d3d11::createDevice( deviceDesc );
@@ -461,6 +467,10 @@ void DeviceManager_DX11::ResizeSwapChain()
 void DeviceManager_DX11::Present()
 {
 	m_SwapChain->Present( m_DeviceParams.vsyncEnabled ? 1 : 0, 0 );
+
+	m_PresentMode = m_DeviceParams.vsyncEnabled ? PresentModes::Fifo : PresentModes::Immediate;
+
+	UpdateFrameTime();
 }
 
 DeviceManager* DeviceManager::CreateD3D11()
@@ -99,6 +99,16 @@ public:
 		return nvrhi::GraphicsAPI::D3D12;
 	}
 
+	uint64_t GetCurrentFrameValue() const override
+	{
+		return m_FrameCount - 1;
+	}
+
+	uint64_t GetCompletedFrameValue() const override
+	{
+		return m_FrameFence ? m_FrameFence->GetCompletedValue() : 0;
+	}
+
 protected:
 	bool CreateDeviceAndSwapChain() override;
 	void DestroyDeviceAndSwapChain() override;
@@ -216,6 +226,12 @@ void DeviceManager_DX12::ReportLiveObjects()
 
 bool DeviceManager_DX12::CreateDeviceAndSwapChain()
 {
+	if ( m_DeviceParams.headless )
+	{
+		Error( "Headless mode is only supported on Vulkan" );
+		return false;
+	}
+
 	UINT windowStyle = m_DeviceParams.startFullscreen
 		? (WS_POPUP | WS_SYSMENU | WS_VISIBLE)
 		: m_DeviceParams.startMaximized
@@ -405,7 +421,7 @@ bool DeviceManager_DX12::CreateDeviceAndSwapChain()
 	HR_RETURN( hr );
 
 	nvrhi::d3d12::DeviceDesc deviceDesc;
-	deviceDesc.errorCB = m_DeviceParams.messageCallback;
+	deviceDesc.errorCB = GetNvrhiMessageCallback();
 	deviceDesc.pDevice = m_Device12;
 	deviceDesc.pGraphicsCommandQueue = m_GraphicsQueue;
 	deviceDesc.pComputeCommandQueue = m_ComputeQueue;
@@ -609,9 +625,19 @@ void DeviceManager_DX12::Present()
 
 	m_SwapChain->Present( m_DeviceParams.vsyncEnabled ? 1 : 0, presentFlags );
 
+	// Without tearing, a flip model swap chain in windowed mode just replaces the queued frame
+	if ( m_DeviceParams.vsyncEnabled )
+		m_PresentMode = PresentModes::Fifo;
+	else if ( (presentFlags & DXGI_PRESENT_ALLOW_TEARING) || !m_FullScreenDesc.Windowed )
+		m_PresentMode = PresentModes::Immediate;
+	else
+		m_PresentMode = PresentModes::Mailbox;
+
 	m_FrameFence->SetEventOnCompletion( m_FrameCount, m_FrameFenceEvents[bufferIndex] );
 	m_GraphicsQueue->Signal( m_FrameFence, m_FrameCount );
 	m_FrameCount++;
+
+	UpdateFrameTime();
 }
 
 DeviceManager* DeviceManager::CreateD3D12( void )
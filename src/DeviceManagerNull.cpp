@@ -0,0 +1,213 @@
+// A DeviceManager without a GPU behind it, for measuring and debugging the CPU side of this library
+// (frame pacing, resizing, frame time bookkeeping) without any driver cost mixed in.
+// There is no nvrhi device, GetDevice and the back buffers are null. Frames "complete" on a simulated
+// GPU that takes DeviceCreationParameters::nullGpuFrameTime per frame and runs them back to back.
+
+#include "elegy-rhi/DeviceManager.hpp"
+#include "elegy-rhi/Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+
+using namespace nvrhi::app;
+
+static const char* GetEmulatedApiName( nvrhi::GraphicsAPI api )
+{
+	switch ( api )
+	{
+	case nvrhi::GraphicsAPI::D3D11: return "D3D11";
+	case nvrhi::GraphicsAPI::D3D12: return "D3D12";
+	case nvrhi::GraphicsAPI::VULKAN: return "VULKAN";
+	}
+
+	return "unknown";
+}
+
+class DeviceManager_Null : public DeviceManager
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct PendingFrame
+	{
+		uint64_t frameValue = 0;
+		Clock::time_point completionTime;
+	};
+
+	nvrhi::GraphicsAPI m_EmulatedApi;
+	std::string m_RendererString;
+
+	uint32_t m_BackBufferIndex = 0;
+	uint64_t m_FrameValue = 0;
+	// frames submitted to the simulated GPU that haven't been waited on yet, oldest first
+	std::deque<PendingFrame> m_PendingFrames;
+	uint64_t m_RetiredFrameValue = 0;
+	// when the simulated GPU is done with everything submitted so far
+	Clock::time_point m_GpuBusyUntil;
+
+public:
+	explicit DeviceManager_Null( nvrhi::GraphicsAPI emulatedApi )
+		: m_EmulatedApi( emulatedApi )
+	{
+	}
+
+	[[nodiscard]] const char* GetRendererString() const override
+	{
+		return m_RendererString.c_str();
+	}
+
+	[[nodiscard]] nvrhi::IDevice* GetDevice() const override
+	{
+		return nullptr;
+	}
+
+	[[nodiscard]] nvrhi::GraphicsAPI GetGraphicsAPI() const override
+	{
+		return m_EmulatedApi;
+	}
+
+	[[nodiscard]] uint64_t GetCurrentFrameValue() const override
+	{
+		return m_FrameValue;
+	}
+
+	[[nodiscard]] uint64_t GetCompletedFrameValue() const override;
+
+	nvrhi::ITexture* GetCurrentBackBuffer() override
+	{
+		return nullptr;
+	}
+
+	nvrhi::ITexture* GetBackBuffer( uint32_t index ) override
+	{
+		return nullptr;
+	}
+
+	uint32_t GetCurrentBackBufferIndex() override
+	{
+		return m_BackBufferIndex;
+	}
+
+	uint32_t GetBackBufferCount() override
+	{
+		return m_DeviceParams.swapChainBufferCount;
+	}
+
+	void BeginFrame() override;
+	void Present() override;
+
+protected:
+	bool CreateDeviceAndSwapChain() override;
+	bool CreateDeviceOnly() override
+	{
+		return CreateDeviceAndSwapChain();
+	}
+	bool CreateWindowSurfaceAndSwapChain() override
+	{
+		// there's no swap chain to begin with
+		return true;
+	}
+	void DestroyDeviceAndSwapChain() override;
+	void ResizeSwapChain() override;
+
+private:
+	void waitForFrameValue( uint64_t frameValue );
+};
+
+uint64_t DeviceManager_Null::GetCompletedFrameValue() const
+{
+	const Clock::time_point now = Clock::now();
+
+	uint64_t completed = m_RetiredFrameValue;
+	for ( const PendingFrame& frame : m_PendingFrames )
+	{
+		if ( frame.completionTime > now )
+			break;
+
+		completed = frame.frameValue;
+	}
+
+	return completed;
+}
+
+void DeviceManager_Null::waitForFrameValue( uint64_t frameValue )
+{
+	ELR_TRACE_SCOPE( "WaitForFrame" );
+
+	while ( !m_PendingFrames.empty() && m_PendingFrames.front().frameValue <= frameValue )
+	{
+		std::this_thread::sleep_until( m_PendingFrames.front().completionTime );
+
+		m_RetiredFrameValue = m_PendingFrames.front().frameValue;
+		m_PendingFrames.pop_front();
+	}
+}
+
+bool DeviceManager_Null::CreateDeviceAndSwapChain()
+{
+	if ( m_DeviceParams.swapChainBufferCount == 0 )
+	{
+		Error( "swapChainBufferCount must be at least 1" );
+		return false;
+	}
+
+	m_RendererString = std::string( "Null (emulating " ) + GetEmulatedApiName( m_EmulatedApi ) + ")";
+	m_GpuBusyUntil = Clock::now();
+
+	Log( m_DeviceParams.infoLogSeverity, "Created a null device: %s", m_RendererString );
+
+	return true;
+}
+
+void DeviceManager_Null::DestroyDeviceAndSwapChain()
+{
+	// same as a device wait idle
+	waitForFrameValue( m_FrameValue );
+
+	m_RendererString.clear();
+}
+
+void DeviceManager_Null::ResizeSwapChain()
+{
+	// Nothing to recreate, the frames in flight don't reference any images
+	m_BackBufferIndex = 0;
+}
+
+void DeviceManager_Null::BeginFrame()
+{
+	ELR_TRACE_SCOPE( "BeginFrame" );
+
+	m_BackBufferIndex = uint32_t( m_FrameValue % m_DeviceParams.swapChainBufferCount );
+}
+
+void DeviceManager_Null::Present()
+{
+	ELR_TRACE_SCOPE( "Present" );
+
+	m_PresentMode = m_DeviceParams.vsyncEnabled ? PresentModes::Fifo : PresentModes::Immediate;
+
+	// The simulated GPU picks the frame up as soon as it's done with the previous one
+	const auto gpuFrameTime = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>( std::max( m_DeviceParams.nullGpuFrameTime, 0.0 ) ) );
+	m_GpuBusyUntil = std::max( m_GpuBusyUntil, Clock::now() ) + gpuFrameTime;
+
+	m_FrameValue++;
+	m_PendingFrames.push_back( { m_FrameValue, m_GpuBusyUntil } );
+
+	// Keep at most GetFramesInFlight() frames queued up on the GPU, like the real backends
+	const uint64_t waitFrameValue = PrepareFrameWait();
+	if ( waitFrameValue > 0 )
+	{
+		const BlockingTimer timer( *this, BlockingCalls::FrameWait );
+		waitForFrameValue( waitFrameValue );
+	}
+
+	UpdateFrameTime();
+}
+
+DeviceManager* DeviceManager::CreateNull( nvrhi::GraphicsAPI emulatedApi )
+{
+	return new DeviceManager_Null( emulatedApi );
+}
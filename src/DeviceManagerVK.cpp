@@ -1,1096 +1,2479 @@
-/*
-* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
-*
-* Permission is hereby granted, free of charge, to any person obtaining a
-* copy of this software and associated documentation files (the "Software"),
-* to deal in the Software without restriction, including without limitation
-* the rights to use, copy, modify, merge, publish, distribute, sublicense,
-* and/or sell copies of the Software, and to permit persons to whom the
-* Software is furnished to do so, subject to the following conditions:
-*
-* The above copyright notice and this permission notice shall be included in
-* all copies or substantial portions of the Software.
-*
-* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
-* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
-* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
-* DEALINGS IN THE SOFTWARE.
-*/
-
-// Adapted from Donut's DeviceManagerVK
-// https://github.com/NVIDIAGameWorks/donut/blob/main/src/app/vulkan/DeviceManager_VK.cpp
-
-#include <string>
-#include <queue>
-#include <unordered_set>
-
-#include "elegy-rhi/DeviceManager.hpp"
-
-#include <nvrhi/vulkan.h>
-#include <nvrhi/validation.h>
-
-using namespace nvrhi::app;
-
-const char* va( const char* message, ... )
-{
-	static char buffer[4096];
-	va_list arguments;
-
-	va_start( arguments, message );
-	vsprintf( buffer, message, arguments );
-	va_end( arguments );
-
-	return buffer;
-}
-
-// Define the Vulkan dynamic dispatcher - this needs to occur in exactly one cpp file in the program.
-VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
-
-class DeviceManager_VK : public DeviceManager
-{
-public:
-	[[nodiscard]] nvrhi::IDevice* GetDevice() const override
-	{
-		if ( m_ValidationLayer )
-			return m_ValidationLayer;
-
-		return m_NvrhiDevice;
-	}
-
-	[[nodiscard]] nvrhi::GraphicsAPI GetGraphicsAPI() const override
-	{
-		return nvrhi::GraphicsAPI::VULKAN;
-	}
-
-protected:
-	bool CreateDeviceAndSwapChain() override;
-	void DestroyDeviceAndSwapChain() override;
-
-	void ResizeSwapChain() override
-	{
-		if ( m_VulkanDevice )
-		{
-			destroySwapChain();
-			createSwapChain();
-		}
-	}
-
-	nvrhi::ITexture* GetCurrentBackBuffer() override
-	{
-		return m_SwapChainImages[m_SwapChainIndex].rhiHandle;
-	}
-	nvrhi::ITexture* GetBackBuffer( uint32_t index ) override
-	{
-		if ( index < m_SwapChainImages.size() )
-			return m_SwapChainImages[index].rhiHandle;
-		return nullptr;
-	}
-	uint32_t GetCurrentBackBufferIndex() override
-	{
-		return m_SwapChainIndex;
-	}
-	uint32_t GetBackBufferCount() override
-	{
-		return uint32_t( m_SwapChainImages.size() );
-	}
-
-	void BeginFrame() override;
-	void Present() override;
-
-	const char* GetRendererString() const override
-	{
-		return m_RendererString.c_str();
-	}
-
-	bool IsVulkanInstanceExtensionEnabled( const char* extensionName ) const override
-	{
-		return enabledExtensions.instance.find( extensionName ) != enabledExtensions.instance.end();
-	}
-
-	bool IsVulkanDeviceExtensionEnabled( const char* extensionName ) const override
-	{
-		return enabledExtensions.device.find( extensionName ) != enabledExtensions.device.end();
-	}
-
-	bool IsVulkanLayerEnabled( const char* layerName ) const override
-	{
-		return enabledExtensions.layers.find( layerName ) != enabledExtensions.layers.end();
-	}
-
-	void GetEnabledVulkanInstanceExtensions( std::vector<std::string>& extensions ) const override
-	{
-		for ( const auto& ext : enabledExtensions.instance )
-			extensions.push_back( ext );
-	}
-
-	void GetEnabledVulkanDeviceExtensions( std::vector<std::string>& extensions ) const override
-	{
-		for ( const auto& ext : enabledExtensions.device )
-			extensions.push_back( ext );
-	}
-
-	void GetEnabledVulkanLayers( std::vector<std::string>& layers ) const override
-	{
-		for ( const auto& ext : enabledExtensions.layers )
-			layers.push_back( ext );
-	}
-
-private:
-	bool createInstance();
-	bool createWindowSurface();
-	void installDebugCallback();
-	bool pickPhysicalDevice();
-	bool findQueueFamilies( vk::PhysicalDevice physicalDevice );
-	bool createDevice();
-	bool createSwapChain();
-	void destroySwapChain();
-	bool getPhysicalDevicePresentationSupport( vk::PhysicalDevice& physicalDevice, int queueFamilyIndex );
-
-	struct VulkanExtensionSet
-	{
-		std::unordered_set<std::string> instance;
-		std::unordered_set<std::string> layers;
-		std::unordered_set<std::string> device;
-	};
-
-	// minimal set of required extensions
-	VulkanExtensionSet enabledExtensions = {
-		// instance
-		{
-			VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
-		},
-		// layers
-		{ },
-		// device
-		{
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-			VK_KHR_MAINTENANCE1_EXTENSION_NAME
-		},
-	};
-
-	// optional extensions
-	VulkanExtensionSet optionalExtensions = {
-		// instance
-		{
-			VK_EXT_SAMPLER_FILTER_MINMAX_EXTENSION_NAME,
-			VK_EXT_DEBUG_UTILS_EXTENSION_NAME
-		},
-		// layers
-		{ },
-		// device
-		{
-			VK_EXT_DEBUG_MARKER_EXTENSION_NAME,
-			VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
-			VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
-			VK_NV_MESH_SHADER_EXTENSION_NAME,
-			VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME
-		},
-	};
-
-	std::unordered_set<std::string> m_RayTracingExtensions = {
-		VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
-		VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
-		VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
-		VK_KHR_RAY_QUERY_EXTENSION_NAME,
-		VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME
-	};
-
-	std::string m_RendererString;
-
-	vk::Instance m_VulkanInstance;
-	vk::DebugReportCallbackEXT m_DebugReportCallback;
-
-	vk::PhysicalDevice m_VulkanPhysicalDevice;
-	int m_GraphicsQueueFamily = -1;
-	int m_ComputeQueueFamily = -1;
-	int m_TransferQueueFamily = -1;
-	int m_PresentQueueFamily = -1;
-
-	vk::Device m_VulkanDevice;
-	vk::Queue m_GraphicsQueue;
-	vk::Queue m_ComputeQueue;
-	vk::Queue m_TransferQueue;
-	vk::Queue m_PresentQueue;
-
-	vk::SurfaceKHR m_WindowSurface;
-
-	vk::SurfaceFormatKHR m_SwapChainFormat;
-	vk::SwapchainKHR m_SwapChain;
-
-	struct SwapChainImage
-	{
-		vk::Image image;
-		nvrhi::TextureHandle rhiHandle;
-	};
-
-	std::vector<SwapChainImage> m_SwapChainImages;
-	uint32_t m_SwapChainIndex = uint32_t( -1 );
-
-	nvrhi::vulkan::DeviceHandle m_NvrhiDevice;
-	nvrhi::DeviceHandle m_ValidationLayer;
-
-	nvrhi::CommandListHandle m_BarrierCommandList;
-	vk::Semaphore m_PresentSemaphore;
-
-	std::queue<nvrhi::EventQueryHandle> m_FramesInFlight;
-	std::vector<nvrhi::EventQueryHandle> m_QueryPool;
-
-private:
-	static VKAPI_ATTR VkBool32 VKAPI_CALL vulkanDebugCallback(
-		VkDebugReportFlagsEXT flags,
-		VkDebugReportObjectTypeEXT objType,
-		uint64_t obj,
-		size_t location,
-		int32_t code,
-		const char* layerPrefix,
-		const char* msg,
-		void* userData )
-	{
-		const DeviceManager_VK* manager = (const DeviceManager_VK*)userData;
-
-		if ( manager )
-		{
-			// Vulkan stuff is super wordy
-			const_cast<DeviceManager_VK*>( manager )->Message( 
-				va( "[Vulkan: location=0x%zx code=%d, layerPrefix='%s'] %s", location, code, layerPrefix, msg ), 
-				nvrhi::MessageSeverity::Warning );
-			
-			const auto& ignored = manager->m_DeviceParams.ignoredVulkanValidationMessageLocations;
-			const auto found = std::find( ignored.begin(), ignored.end(), location );
-			if ( found != ignored.end() )
-				return VK_FALSE;
-		}
-
-
-		return VK_FALSE;
-	}
-
-};
-
-static std::vector<const char*> stringSetToVector( const std::unordered_set<std::string>& set )
-{
-	std::vector<const char*> ret;
-	for ( const auto& s : set )
-	{
-		ret.push_back( s.c_str() );
-	}
-
-	return ret;
-}
-
-template <typename T>
-static std::vector<T> setToVector( const std::unordered_set<T>& set )
-{
-	std::vector<T> ret;
-	for ( const auto& s : set )
-	{
-		ret.push_back( s );
-	}
-
-	return ret;
-}
-
-bool DeviceManager_VK::createInstance()
-{
-	// add instance extensions requested by the user
-	for ( const std::string& name : m_DeviceParams.requiredVulkanInstanceExtensions )
-	{
-		enabledExtensions.instance.insert( name );
-	}
-	for ( const std::string& name : m_DeviceParams.optionalVulkanInstanceExtensions )
-	{
-		optionalExtensions.instance.insert( name );
-	}
-
-	// add layers requested by the user
-	for ( const std::string& name : m_DeviceParams.requiredVulkanLayers )
-	{
-		enabledExtensions.layers.insert( name );
-	}
-	for ( const std::string& name : m_DeviceParams.optionalVulkanLayers )
-	{
-		optionalExtensions.layers.insert( name );
-	}
-
-	std::unordered_set<std::string> requiredExtensions = enabledExtensions.instance;
-
-	// figure out which optional extensions are supported
-	for ( const auto& instanceExt : vk::enumerateInstanceExtensionProperties() )
-	{
-		const std::string name = instanceExt.extensionName;
-		if ( optionalExtensions.instance.find( name ) != optionalExtensions.instance.end() )
-		{
-			enabledExtensions.instance.insert( name );
-		}
-
-		requiredExtensions.erase( name );
-	}
-
-	if ( !requiredExtensions.empty() )
-	{
-		std::stringstream ss;
-		ss << "Cannot create a Vulkan instance because the following required extension(s) are not supported:";
-		for ( const auto& ext : requiredExtensions )
-			ss << std::endl << "  - " << ext;
-
-		Error( ss.str().c_str() );
-		return false;
-	}
-
-	Message( "Enabled Vulkan instance extensions:", m_DeviceParams.infoLogSeverity );
-	for ( const auto& ext : enabledExtensions.instance )
-	{
-		Message( va( "    %s", ext.c_str() ), m_DeviceParams.infoLogSeverity );
-	}
-
-	std::unordered_set<std::string> requiredLayers = enabledExtensions.layers;
-
-	for ( const auto& layer : vk::enumerateInstanceLayerProperties() )
-	{
-		const std::string name = layer.layerName;
-		if ( optionalExtensions.layers.find( name ) != optionalExtensions.layers.end() )
-		{
-			enabledExtensions.layers.insert( name );
-		}
-
-		requiredLayers.erase( name );
-	}
-
-	if ( !requiredLayers.empty() )
-	{
-		std::stringstream ss;
-		ss << "Cannot create a Vulkan instance because the following required layer(s) are not supported:";
-		for ( const auto& ext : requiredLayers )
-			ss << std::endl << "  - " << ext;
-
-		Error( ss.str().c_str() );
-		return false;
-	}
-
-	Message( "Enabled Vulkan layers:", m_DeviceParams.infoLogSeverity );
-	for ( const auto& layer : enabledExtensions.layers )
-	{
-		Message( va( "    %s", layer.c_str() ), m_DeviceParams.infoLogSeverity );
-	}
-
-	auto instanceExtVec = stringSetToVector( enabledExtensions.instance );
-	auto layerVec = stringSetToVector( enabledExtensions.layers );
-
-	auto applicationInfo = vk::ApplicationInfo()
-		.setApiVersion( VK_MAKE_VERSION( 1, 2, 0 ) );
-
-	// create the vulkan instance
-	vk::InstanceCreateInfo info = vk::InstanceCreateInfo()
-		.setEnabledLayerCount( uint32_t( layerVec.size() ) )
-		.setPpEnabledLayerNames( layerVec.data() )
-		.setEnabledExtensionCount( uint32_t( instanceExtVec.size() ) )
-		.setPpEnabledExtensionNames( instanceExtVec.data() )
-		.setPApplicationInfo( &applicationInfo );
-
-	const vk::Result res = vk::createInstance( &info, nullptr, &m_VulkanInstance );
-	if ( res != vk::Result::eSuccess )
-	{
-		Error( va( "Failed to create a Vulkan instance, error code = %s", nvrhi::vulkan::resultToString( res ) ) );
-		return false;
-	}
-
-	VULKAN_HPP_DEFAULT_DISPATCHER.init( m_VulkanInstance );
-
-	return true;
-}
-
-void DeviceManager_VK::installDebugCallback()
-{
-	auto info = vk::DebugReportCallbackCreateInfoEXT()
-		.setFlags( vk::DebugReportFlagBitsEXT::eError |
-		vk::DebugReportFlagBitsEXT::eWarning |
-		//   vk::DebugReportFlagBitsEXT::eInformation |
-		vk::DebugReportFlagBitsEXT::ePerformanceWarning )
-		.setPfnCallback( vulkanDebugCallback )
-		.setPUserData( this );
-
-	vk::Result res = m_VulkanInstance.createDebugReportCallbackEXT( &info, nullptr, &m_DebugReportCallback );
-	assert( res == vk::Result::eSuccess );
-}
-
-bool DeviceManager_VK::pickPhysicalDevice()
-{
-	vk::Format requestedFormat = nvrhi::vulkan::convertFormat( m_DeviceParams.swapChainFormat );
-	vk::Extent2D requestedExtent( m_DeviceParams.backBufferWidth, m_DeviceParams.backBufferHeight );
-
-	auto devices = m_VulkanInstance.enumeratePhysicalDevices();
-
-	// Start building an error message in case we cannot find a device.
-	std::stringstream errorStream;
-	errorStream << "Cannot find a Vulkan device that supports all the required extensions and properties.";
-
-	// build a list of GPUs
-	std::vector<vk::PhysicalDevice> discreteGPUs;
-	std::vector<vk::PhysicalDevice> otherGPUs;
-	for ( const auto& dev : devices )
-	{
-		auto prop = dev.getProperties();
-
-		errorStream << std::endl << prop.deviceName.data() << ":";
-
-		// check that all required device extensions are present
-		std::unordered_set<std::string> requiredExtensions = enabledExtensions.device;
-		auto deviceExtensions = dev.enumerateDeviceExtensionProperties();
-		for ( const auto& ext : deviceExtensions )
-		{
-			requiredExtensions.erase( std::string( ext.extensionName.data() ) );
-		}
-
-		bool deviceIsGood = true;
-
-		if ( !requiredExtensions.empty() )
-		{
-			// device is missing one or more required extensions
-			for ( const auto& ext : requiredExtensions )
-			{
-				errorStream << std::endl << "  - missing " << ext;
-			}
-			deviceIsGood = false;
-		}
-
-		auto deviceFeatures = dev.getFeatures();
-		if ( !deviceFeatures.samplerAnisotropy )
-		{
-			// device is a toaster oven
-			errorStream << std::endl << "  - does not support samplerAnisotropy";
-			deviceIsGood = false;
-		}
-		if ( !deviceFeatures.textureCompressionBC )
-		{
-			errorStream << std::endl << "  - does not support textureCompressionBC";
-			deviceIsGood = false;
-		}
-
-		// check that this device supports our intended swap chain creation parameters
-		auto surfaceCaps = dev.getSurfaceCapabilitiesKHR( m_WindowSurface );
-		auto surfaceFmts = dev.getSurfaceFormatsKHR( m_WindowSurface );
-		auto surfacePModes = dev.getSurfacePresentModesKHR( m_WindowSurface );
-
-		if ( surfaceCaps.minImageCount > m_DeviceParams.swapChainBufferCount ||
-			(surfaceCaps.maxImageCount < m_DeviceParams.swapChainBufferCount && surfaceCaps.maxImageCount > 0) )
-		{
-			errorStream << std::endl << "  - cannot support the requested swap chain image count:";
-			errorStream << " requested " << m_DeviceParams.swapChainBufferCount << ", available " << surfaceCaps.minImageCount << " - " << surfaceCaps.maxImageCount;
-			deviceIsGood = false;
-		}
-
-		if ( surfaceCaps.minImageExtent.width > requestedExtent.width ||
-			surfaceCaps.minImageExtent.height > requestedExtent.height ||
-			surfaceCaps.maxImageExtent.width < requestedExtent.width ||
-			surfaceCaps.maxImageExtent.height < requestedExtent.height )
-		{
-			errorStream << std::endl << "  - cannot support the requested swap chain size:";
-			errorStream << " requested " << requestedExtent.width << "x" << requestedExtent.height << ", ";
-			errorStream << " available " << surfaceCaps.minImageExtent.width << "x" << surfaceCaps.minImageExtent.height;
-			errorStream << " - " << surfaceCaps.maxImageExtent.width << "x" << surfaceCaps.maxImageExtent.height;
-			deviceIsGood = false;
-		}
-
-		bool surfaceFormatPresent = false;
-		for ( const vk::SurfaceFormatKHR& surfaceFmt : surfaceFmts )
-		{
-			if ( surfaceFmt.format == requestedFormat )
-			{
-				surfaceFormatPresent = true;
-				break;
-			}
-		}
-
-		if ( !surfaceFormatPresent )
-		{
-			// can't create a swap chain using the format requested
-			errorStream << std::endl << "  - does not support the requested swap chain format";
-			deviceIsGood = false;
-		}
-
-		if ( !findQueueFamilies( dev ) )
-		{
-			// device doesn't have all the queue families we need
-			errorStream << std::endl << "  - does not support the necessary queue types";
-			deviceIsGood = false;
-		}
-
-		// check that we can present from the graphics queue
-		uint32_t canPresent = dev.getSurfaceSupportKHR( m_GraphicsQueueFamily, m_WindowSurface );
-		if ( !canPresent )
-		{
-			errorStream << std::endl << "  - cannot present";
-			deviceIsGood = false;
-		}
-
-		if ( !deviceIsGood )
-			continue;
-
-		if ( prop.deviceType == vk::PhysicalDeviceType::eDiscreteGpu )
-		{
-			discreteGPUs.push_back( dev );
-		}
-		else {
-			otherGPUs.push_back( dev );
-		}
-	}
-
-	// pick the first discrete GPU if it exists, otherwise the first integrated GPU
-	if ( !discreteGPUs.empty() )
-	{
-		m_VulkanPhysicalDevice = discreteGPUs[0];
-		return true;
-	}
-
-	if ( !otherGPUs.empty() )
-	{
-		m_VulkanPhysicalDevice = otherGPUs[0];
-		return true;
-	}
-
-	Error( errorStream.str().c_str() );
-
-	return false;
-}
-
-bool DeviceManager_VK::findQueueFamilies( vk::PhysicalDevice physicalDevice )
-{
-	auto props = physicalDevice.getQueueFamilyProperties();
-
-	Message( va( "Physical device has %i queue families", int( props.size() ) ) );
-
-	for ( int i = 0; i < int( props.size() ); i++ )
-	{
-		const auto& queueFamily = props[i];
-
-		if ( m_GraphicsQueueFamily == -1 )
-		{
-			if ( queueFamily.queueCount > 0 &&
-				(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) )
-			{
-				m_GraphicsQueueFamily = i;
-			}
-		}
-
-		if ( m_ComputeQueueFamily == -1 )
-		{
-			if ( queueFamily.queueCount > 0 &&
-				(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) &&
-				!(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) )
-			{
-				m_ComputeQueueFamily = i;
-			}
-		}
-
-		if ( m_TransferQueueFamily == -1 )
-		{
-			if ( queueFamily.queueCount > 0 &&
-				(queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) &&
-				!(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) &&
-				!(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) )
-			{
-				m_TransferQueueFamily = i;
-			}
-		}
-
-		if ( m_PresentQueueFamily == -1 )
-		{
-			if ( queueFamily.queueCount > 0 &&
-				getPhysicalDevicePresentationSupport( physicalDevice, i ) )
-			{
-				m_PresentQueueFamily = i;
-			}
-		}
-	}
-
-	if ( m_GraphicsQueueFamily == -1 ||
-		m_PresentQueueFamily == -1 ||
-		(m_ComputeQueueFamily == -1 && m_DeviceParams.enableComputeQueue) ||
-		(m_TransferQueueFamily == -1 && m_DeviceParams.enableCopyQueue) )
-	{
-		return false;
-	}
-
-	return true;
-}
-
-bool DeviceManager_VK::createDevice()
-{
-	// figure out which optional extensions are supported
-	auto deviceExtensions = m_VulkanPhysicalDevice.enumerateDeviceExtensionProperties();
-	for ( const auto& ext : deviceExtensions )
-	{
-		const std::string name = ext.extensionName;
-		if ( optionalExtensions.device.find( name ) != optionalExtensions.device.end() )
-		{
-			enabledExtensions.device.insert( name );
-		}
-
-		if ( m_DeviceParams.enableRayTracingExtensions && m_RayTracingExtensions.find( name ) != m_RayTracingExtensions.end() )
-		{
-			enabledExtensions.device.insert( name );
-		}
-	}
-
-	bool accelStructSupported = false;
-	bool bufferAddressSupported = false;
-	bool rayPipelineSupported = false;
-	bool rayQuerySupported = false;
-	bool meshletsSupported = false;
-	bool vrsSupported = false;
-
-	Message( "Enabled Vulkan device extensions:", m_DeviceParams.infoLogSeverity );
-	for ( const auto& ext : enabledExtensions.device )
-	{
-		Message( va( "    %s", ext.c_str() ), m_DeviceParams.infoLogSeverity );
-
-		if ( ext == VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME )
-			accelStructSupported = true;
-		else if ( ext == VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME )
-			bufferAddressSupported = true;
-		else if ( ext == VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME )
-			rayPipelineSupported = true;
-		else if ( ext == VK_KHR_RAY_QUERY_EXTENSION_NAME )
-			rayQuerySupported = true;
-		else if ( ext == VK_NV_MESH_SHADER_EXTENSION_NAME )
-			meshletsSupported = true;
-		else if ( ext == VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME )
-			vrsSupported = true;
-	}
-
-	std::unordered_set<int> uniqueQueueFamilies = {
-		m_GraphicsQueueFamily,
-		m_PresentQueueFamily };
-
-	if ( m_DeviceParams.enableComputeQueue )
-		uniqueQueueFamilies.insert( m_ComputeQueueFamily );
-
-	if ( m_DeviceParams.enableCopyQueue )
-		uniqueQueueFamilies.insert( m_TransferQueueFamily );
-
-	float priority = 1.f;
-	std::vector<vk::DeviceQueueCreateInfo> queueDesc;
-	for ( int queueFamily : uniqueQueueFamilies )
-	{
-		queueDesc.push_back( vk::DeviceQueueCreateInfo()
-			.setQueueFamilyIndex( queueFamily )
-			.setQueueCount( 1 )
-			.setPQueuePriorities( &priority ) );
-	}
-
-	auto accelStructFeatures = vk::PhysicalDeviceAccelerationStructureFeaturesKHR()
-		.setAccelerationStructure( true );
-	auto bufferAddressFeatures = vk::PhysicalDeviceBufferAddressFeaturesEXT()
-		.setBufferDeviceAddress( true );
-	auto rayPipelineFeatures = vk::PhysicalDeviceRayTracingPipelineFeaturesKHR()
-		.setRayTracingPipeline( true )
-		.setRayTraversalPrimitiveCulling( true );
-	auto rayQueryFeatures = vk::PhysicalDeviceRayQueryFeaturesKHR()
-		.setRayQuery( true );
-	auto meshletFeatures = vk::PhysicalDeviceMeshShaderFeaturesNV()
-		.setTaskShader( true )
-		.setMeshShader( true );
-	auto vrsFeatures = vk::PhysicalDeviceFragmentShadingRateFeaturesKHR()
-		.setPipelineFragmentShadingRate( true )
-		.setPrimitiveFragmentShadingRate( true )
-		.setAttachmentFragmentShadingRate( true );
-
-	void* pNext = nullptr;
-#define APPEND_EXTENSION(condition, desc) if (condition) { (desc).pNext = pNext; pNext = &(desc); }  // NOLINT(cppcoreguidelines-macro-usage)
-	APPEND_EXTENSION( accelStructSupported, accelStructFeatures )
-		APPEND_EXTENSION( bufferAddressSupported, bufferAddressFeatures )
-		APPEND_EXTENSION( rayPipelineSupported, rayPipelineFeatures )
-		APPEND_EXTENSION( rayQuerySupported, rayQueryFeatures )
-		APPEND_EXTENSION( meshletsSupported, meshletFeatures )
-		APPEND_EXTENSION( vrsSupported, vrsFeatures )
-#undef APPEND_EXTENSION
-
-		auto deviceFeatures = vk::PhysicalDeviceFeatures()
-		.setShaderImageGatherExtended( true )
-		.setSamplerAnisotropy( true )
-		.setTessellationShader( true )
-		.setTextureCompressionBC( true )
-		.setGeometryShader( true )
-		.setImageCubeArray( true )
-		.setDualSrcBlend( true );
-
-	auto vulkan12features = vk::PhysicalDeviceVulkan12Features()
-		.setDescriptorIndexing( true )
-		.setRuntimeDescriptorArray( true )
-		.setDescriptorBindingPartiallyBound( true )
-		.setDescriptorBindingVariableDescriptorCount( true )
-		.setTimelineSemaphore( true )
-		.setShaderSampledImageArrayNonUniformIndexing( true )
-		.setPNext( pNext );
-
-	auto layerVec = stringSetToVector( enabledExtensions.layers );
-	auto extVec = stringSetToVector( enabledExtensions.device );
-
-	auto deviceDesc = vk::DeviceCreateInfo()
-		.setPQueueCreateInfos( queueDesc.data() )
-		.setQueueCreateInfoCount( uint32_t( queueDesc.size() ) )
-		.setPEnabledFeatures( &deviceFeatures )
-		.setEnabledExtensionCount( uint32_t( extVec.size() ) )
-		.setPpEnabledExtensionNames( extVec.data() )
-		.setEnabledLayerCount( uint32_t( layerVec.size() ) )
-		.setPpEnabledLayerNames( layerVec.data() )
-		.setPNext( &vulkan12features );
-
-	//if ( m_DeviceParams.deviceCreateInfoCallback )
-	//	m_DeviceParams.deviceCreateInfoCallback( deviceDesc );
-
-	const vk::Result res = m_VulkanPhysicalDevice.createDevice( &deviceDesc, nullptr, &m_VulkanDevice );
-	if ( res != vk::Result::eSuccess )
-	{
-		Error( va( "Failed to create a Vulkan physical device, error code = %s", nvrhi::vulkan::resultToString( res ) ) );
-		return false;
-	}
-
-	m_VulkanDevice.getQueue( m_GraphicsQueueFamily, 0, &m_GraphicsQueue );
-	if ( m_DeviceParams.enableComputeQueue )
-		m_VulkanDevice.getQueue( m_ComputeQueueFamily, 0, &m_ComputeQueue );
-	if ( m_DeviceParams.enableCopyQueue )
-		m_VulkanDevice.getQueue( m_TransferQueueFamily, 0, &m_TransferQueue );
-	m_VulkanDevice.getQueue( m_PresentQueueFamily, 0, &m_PresentQueue );
-
-	VULKAN_HPP_DEFAULT_DISPATCHER.init( m_VulkanDevice );
-
-	// stash the renderer string
-	auto prop = m_VulkanPhysicalDevice.getProperties();
-	m_RendererString = std::string( prop.deviceName.data() );
-
-	Message( va( "Created Vulkan device: %s", m_RendererString.c_str() ), m_DeviceParams.infoLogSeverity );
-
-	return true;
-}
-
-bool DeviceManager_VK::createWindowSurface()
-{
-	vk::Result res = vk::Result::eErrorUnknown;
-
-#if VK_USE_PLATFORM_WIN32_KHR
-	const auto& window = m_DeviceParams.windowSurfaceData;
-	const auto surfaceCreateInfo = vk::Win32SurfaceCreateInfoKHR{ {}, window.hInstance, window.hWindow };
-
-	res = m_VulkanInstance.createWin32SurfaceKHR( &surfaceCreateInfo, nullptr, &m_WindowSurface );
-#elif VK_USE_PLATFORM_XLIB_KHR
-	const auto& window = m_DeviceParams.windowSurfaceData;
-	const auto surfaceCreateInfo = vk::XlibSurfaceCreateInfoKHR{ {}, window.display, window.window };
-
-	res = m_VulkanInstance.createXlibSurfaceKHR( &surfaceCreateInfo, nullptr, &m_WindowSurface );
-#elif VK_USE_PLATFORM_WAYLAND_KHR
-#error "Wayland is not yet supported"
-#endif
-
-	if ( res != vk::Result::eSuccess )
-	{
-		Error( va( "Failed to create a window surface, error code = %s", nvrhi::vulkan::resultToString( res ) ) );
-		return false;
-	}
-
-	return true;
-}
-
-bool DeviceManager_VK::getPhysicalDevicePresentationSupport( vk::PhysicalDevice& physicalDevice, int queueFamilyIndex )
-{
-#if VK_USE_PLATFORM_WIN32_KHR
-	return physicalDevice.getWin32PresentationSupportKHR( queueFamilyIndex );
-#elif VK_USE_PLATFORM_XLIB_KHR
-	const auto& window = m_DeviceParams.windowSurfaceData;
-
-	// Screen is hardcoded to 0 here, investigate later on to support multiple monitors maybe???
-	VisualID visualId = XVisualIDFromVisual( DefaultVisual( window.display, 0 ) );
-	return physicalDevice.getXlibPresentationSupportKHR( queueFamilyIndex, window.display, visualId );
-#else
-	return false;
-#endif
-}
-
-void DeviceManager_VK::destroySwapChain()
-{
-	if ( m_VulkanDevice )
-	{
-		m_VulkanDevice.waitIdle();
-	}
-
-	if ( m_SwapChain )
-	{
-		m_VulkanDevice.destroySwapchainKHR( m_SwapChain );
-		m_SwapChain = nullptr;
-	}
-
-	m_SwapChainImages.clear();
-}
-
-bool DeviceManager_VK::createSwapChain()
-{
-	destroySwapChain();
-
-	m_SwapChainFormat = {
-		vk::Format( nvrhi::vulkan::convertFormat( m_DeviceParams.swapChainFormat ) ),
-		vk::ColorSpaceKHR::eSrgbNonlinear
-	};
-
-	vk::Extent2D extent = vk::Extent2D( m_DeviceParams.backBufferWidth, m_DeviceParams.backBufferHeight );
-
-	std::unordered_set<uint32_t> uniqueQueues = {
-		uint32_t( m_GraphicsQueueFamily ),
-		uint32_t( m_PresentQueueFamily ) };
-
-	std::vector<uint32_t> queues = setToVector( uniqueQueues );
-
-	const bool enableSwapChainSharing = queues.size() > 1;
-
-	auto desc = vk::SwapchainCreateInfoKHR()
-		.setSurface( m_WindowSurface )
-		.setMinImageCount( m_DeviceParams.swapChainBufferCount )
-		.setImageFormat( m_SwapChainFormat.format )
-		.setImageColorSpace( m_SwapChainFormat.colorSpace )
-		.setImageExtent( extent )
-		.setImageArrayLayers( 1 )
-		.setImageUsage( vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled )
-		.setImageSharingMode( enableSwapChainSharing ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive )
-		.setQueueFamilyIndexCount( enableSwapChainSharing ? uint32_t( queues.size() ) : 0 )
-		.setPQueueFamilyIndices( enableSwapChainSharing ? queues.data() : nullptr )
-		.setPreTransform( vk::SurfaceTransformFlagBitsKHR::eIdentity )
-		.setCompositeAlpha( vk::CompositeAlphaFlagBitsKHR::eOpaque )
-		.setPresentMode( m_DeviceParams.vsyncEnabled ? vk::PresentModeKHR::eFifo : vk::PresentModeKHR::eImmediate )
-		.setClipped( true )
-		.setOldSwapchain( nullptr );
-
-	const vk::Result res = m_VulkanDevice.createSwapchainKHR( &desc, nullptr, &m_SwapChain );
-	if ( res != vk::Result::eSuccess )
-	{
-		Error( va( "Failed to create a Vulkan swap chain, error code = %s", nvrhi::vulkan::resultToString( res ) ) );
-		return false;
-	}
-
-	// retrieve swap chain images
-	auto images = m_VulkanDevice.getSwapchainImagesKHR( m_SwapChain );
-	for ( auto image : images )
-	{
-		SwapChainImage sci;
-		sci.image = image;
-
-		nvrhi::TextureDesc textureDesc;
-		textureDesc.width = m_DeviceParams.backBufferWidth;
-		textureDesc.height = m_DeviceParams.backBufferHeight;
-		textureDesc.format = m_DeviceParams.swapChainFormat;
-		textureDesc.debugName = "Swap chain image";
-		textureDesc.initialState = nvrhi::ResourceStates::Present;
-		textureDesc.keepInitialState = true;
-		textureDesc.isRenderTarget = true;
-
-		sci.rhiHandle = m_NvrhiDevice->createHandleForNativeTexture( nvrhi::ObjectTypes::VK_Image, nvrhi::Object( sci.image ), textureDesc );
-		m_SwapChainImages.push_back( sci );
-	}
-
-	m_SwapChainIndex = 0;
-
-	return true;
-}
-
-bool DeviceManager_VK::CreateDeviceAndSwapChain()
-{
-	if ( m_DeviceParams.enableDebugRuntime )
-	{
-		enabledExtensions.instance.insert( "VK_EXT_debug_report" );
-		enabledExtensions.layers.insert( "VK_LAYER_KHRONOS_validation" );
-	}
-
-	const vk::DynamicLoader dl;
-	const PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr =   // NOLINT(misc-misplaced-const)
-		dl.getProcAddress<PFN_vkGetInstanceProcAddr>( "vkGetInstanceProcAddr" );
-	VULKAN_HPP_DEFAULT_DISPATCHER.init( vkGetInstanceProcAddr );
-
-#define CHECK(a) if (!(a)) { return false; }
-
-	CHECK( createInstance() )
-
-		if ( m_DeviceParams.enableDebugRuntime )
-		{
-			installDebugCallback();
-		}
-
-	if ( m_DeviceParams.swapChainFormat == nvrhi::Format::SRGBA8_UNORM )
-		m_DeviceParams.swapChainFormat = nvrhi::Format::SBGRA8_UNORM;
-	else if ( m_DeviceParams.swapChainFormat == nvrhi::Format::RGBA8_UNORM )
-		m_DeviceParams.swapChainFormat = nvrhi::Format::BGRA8_UNORM;
-
-	// add device extensions requested by the user
-	for ( const std::string& name : m_DeviceParams.requiredVulkanDeviceExtensions )
-	{
-		enabledExtensions.device.insert( name );
-	}
-	for ( const std::string& name : m_DeviceParams.optionalVulkanDeviceExtensions )
-	{
-		optionalExtensions.device.insert( name );
-	}
-
-	CHECK( createWindowSurface() )
-		CHECK( pickPhysicalDevice() )
-		CHECK( findQueueFamilies( m_VulkanPhysicalDevice ) )
-		CHECK( createDevice() )
-
-		auto vecInstanceExt = stringSetToVector( enabledExtensions.instance );
-	auto vecLayers = stringSetToVector( enabledExtensions.layers );
-	auto vecDeviceExt = stringSetToVector( enabledExtensions.device );
-
-	nvrhi::vulkan::DeviceDesc deviceDesc;
-	deviceDesc.errorCB = m_DeviceParams.messageCallback;
-	deviceDesc.instance = m_VulkanInstance;
-	deviceDesc.physicalDevice = m_VulkanPhysicalDevice;
-	deviceDesc.device = m_VulkanDevice;
-	deviceDesc.graphicsQueue = m_GraphicsQueue;
-	deviceDesc.graphicsQueueIndex = m_GraphicsQueueFamily;
-	if ( m_DeviceParams.enableComputeQueue )
-	{
-		deviceDesc.computeQueue = m_ComputeQueue;
-		deviceDesc.computeQueueIndex = m_ComputeQueueFamily;
-	}
-	if ( m_DeviceParams.enableCopyQueue )
-	{
-		deviceDesc.transferQueue = m_TransferQueue;
-		deviceDesc.transferQueueIndex = m_TransferQueueFamily;
-	}
-	deviceDesc.instanceExtensions = vecInstanceExt.data();
-	deviceDesc.numInstanceExtensions = vecInstanceExt.size();
-	deviceDesc.deviceExtensions = vecDeviceExt.data();
-	deviceDesc.numDeviceExtensions = vecDeviceExt.size();
-
-	m_NvrhiDevice = nvrhi::vulkan::createDevice( deviceDesc );
-
-	if ( m_DeviceParams.enableNvrhiValidationLayer )
-	{
-		m_ValidationLayer = nvrhi::validation::createValidationLayer( m_NvrhiDevice );
-	}
-
-	CHECK( createSwapChain() )
-
-		m_BarrierCommandList = m_NvrhiDevice->createCommandList();
-
-	m_PresentSemaphore = m_VulkanDevice.createSemaphore( vk::SemaphoreCreateInfo() );
-
-#undef CHECK
-
-	return true;
-}
-
-void DeviceManager_VK::DestroyDeviceAndSwapChain()
-{
-	destroySwapChain();
-
-	m_VulkanDevice.destroySemaphore( m_PresentSemaphore );
-	m_PresentSemaphore = vk::Semaphore();
-
-	m_BarrierCommandList = nullptr;
-
-	m_NvrhiDevice = nullptr;
-	m_ValidationLayer = nullptr;
-	m_RendererString.clear();
-
-	if ( m_DebugReportCallback )
-	{
-		m_VulkanInstance.destroyDebugReportCallbackEXT( m_DebugReportCallback );
-	}
-
-	if ( m_VulkanDevice )
-	{
-		m_VulkanDevice.destroy();
-		m_VulkanDevice = nullptr;
-	}
-
-	if ( m_WindowSurface )
-	{
-		assert( m_VulkanInstance );
-		m_VulkanInstance.destroySurfaceKHR( m_WindowSurface );
-		m_WindowSurface = nullptr;
-	}
-
-	if ( m_VulkanInstance )
-	{
-		m_VulkanInstance.destroy();
-		m_VulkanInstance = nullptr;
-	}
-}
-
-void DeviceManager_VK::BeginFrame()
-{
-	const vk::Result res = m_VulkanDevice.acquireNextImageKHR( m_SwapChain,
-		std::numeric_limits<uint64_t>::max(), // timeout
-		m_PresentSemaphore,
-		vk::Fence(),
-		&m_SwapChainIndex );
-
-	assert( res == vk::Result::eSuccess );
-
-	m_NvrhiDevice->queueWaitForSemaphore( nvrhi::CommandQueue::Graphics, m_PresentSemaphore, 0 );
-}
-
-void DeviceManager_VK::Present()
-{
-	m_NvrhiDevice->queueSignalSemaphore( nvrhi::CommandQueue::Graphics, m_PresentSemaphore, 0 );
-
-	m_BarrierCommandList->open(); // umm...
-	m_BarrierCommandList->close();
-	m_NvrhiDevice->executeCommandList( m_BarrierCommandList );
-
-	vk::PresentInfoKHR info = vk::PresentInfoKHR()
-		.setWaitSemaphoreCount( 1 )
-		.setPWaitSemaphores( &m_PresentSemaphore )
-		.setSwapchainCount( 1 )
-		.setPSwapchains( &m_SwapChain )
-		.setPImageIndices( &m_SwapChainIndex );
-
-	const vk::Result res = m_PresentQueue.presentKHR( &info );
-	assert( res == vk::Result::eSuccess || res == vk::Result::eErrorOutOfDateKHR );
-
-	if ( m_DeviceParams.enableDebugRuntime )
-	{
-		// according to vulkan-tutorial.com, "the validation layer implementation expects
-		// the application to explicitly synchronize with the GPU"
-		m_PresentQueue.waitIdle();
-	}
-	else
-	{
-#ifndef _WIN32
-		if ( m_DeviceParams.vsyncEnabled )
-		{
-			m_PresentQueue.waitIdle();
-		}
-#endif
-
-		while ( m_FramesInFlight.size() > m_DeviceParams.maxFramesInFlight )
-		{
-			auto query = m_FramesInFlight.front();
-			m_FramesInFlight.pop();
-
-			m_NvrhiDevice->waitEventQuery( query );
-
-			m_QueryPool.push_back( query );
-		}
-
-		nvrhi::EventQueryHandle query;
-		if ( !m_QueryPool.empty() )
-		{
-			query = m_QueryPool.back();
-			m_QueryPool.pop_back();
-		}
-		else
-		{
-			query = m_NvrhiDevice->createEventQuery();
-		}
-
-		m_NvrhiDevice->resetEventQuery( query );
-		m_NvrhiDevice->setEventQuery( query, nvrhi::CommandQueue::Graphics );
-		m_FramesInFlight.push( query );
-	}
-}
-
-DeviceManager* DeviceManager::CreateVK()
-{
-	return new DeviceManager_VK();
-}
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+// Adapted from Donut's DeviceManagerVK
+// https://github.com/NVIDIAGameWorks/donut/blob/main/src/app/vulkan/DeviceManager_VK.cpp
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "elegy-rhi/DeviceManager.hpp"
+#include "elegy-rhi/Trace.hpp"
+#include "elegy-rhi/VulkanExtensions.hpp"
+#include "FileUtils.hpp"
+#include "VulkanHostAllocator.hpp"
+
+#include <nvrhi/vulkan.h>
+#include <nvrhi/validation.h>
+
+using namespace nvrhi::app;
+
+// For building strings, messages go through DeviceManager::Log
+static std::string va( const char* format, ... )
+{
+	va_list arguments;
+
+	va_start( arguments, format );
+	const int length = vsnprintf( nullptr, 0, format, arguments );
+	va_end( arguments );
+
+	std::string result( size_t( std::max( length, 0 ) ), '\0' );
+
+	va_start( arguments, format );
+	vsnprintf( result.data(), result.size() + 1, format, arguments );
+	va_end( arguments );
+
+	return result;
+}
+
+// Define the Vulkan dynamic dispatcher - this needs to occur in exactly one cpp file in the program.
+VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
+
+// Set of extension names, with the ones in Registry (see VulkanExtensions.hpp) kept as bits
+// so they can be tested without hashing strings. Anything else the user asks for goes into a plain string set
+template<typename Registry>
+class ExtensionSet
+{
+public:
+	using Type = typename Registry::Type;
+
+	ExtensionSet() = default;
+	ExtensionSet( std::initializer_list<const char*> names )
+	{
+		for ( const char* name : names )
+			insert( name );
+	}
+
+	void insert( Type extension ) { m_Known.set( extension ); }
+	void insert( const std::string& name )
+	{
+		const Type extension = Registry::Find( name );
+		if ( extension != Registry::Count )
+			m_Known.set( extension );
+		else
+			m_Unknown.insert( name );
+	}
+
+	void erase( Type extension ) { m_Known.reset( extension ); }
+	void erase( const std::string& name )
+	{
+		const Type extension = Registry::Find( name );
+		if ( extension != Registry::Count )
+			m_Known.reset( extension );
+		else
+			m_Unknown.erase( name );
+	}
+
+	[[nodiscard]] bool contains( Type extension ) const { return m_Known.test( extension ); }
+	[[nodiscard]] bool contains( const std::string& name ) const
+	{
+		const Type extension = Registry::Find( name );
+		if ( extension != Registry::Count )
+			return m_Known.test( extension );
+
+		return m_Unknown.find( name ) != m_Unknown.end();
+	}
+
+	[[nodiscard]] bool empty() const { return m_Known.none() && m_Unknown.empty(); }
+
+	// Valid as long as the set isn't modified
+	[[nodiscard]] std::vector<const char*> names() const
+	{
+		std::vector<const char*> result;
+		for ( uint32_t i = 0; i < Registry::Count; i++ )
+		{
+			if ( m_Known.test( i ) )
+				result.push_back( Registry::Names[i] );
+		}
+
+		for ( const std::string& name : m_Unknown )
+			result.push_back( name.c_str() );
+
+		return result;
+	}
+
+private:
+	std::bitset<Registry::Count> m_Known;
+	std::unordered_set<std::string> m_Unknown;
+};
+
+class DeviceManager_VK : public DeviceManager
+{
+public:
+	[[nodiscard]] nvrhi::IDevice* GetDevice() const override
+	{
+		if ( m_ValidationLayer )
+			return m_ValidationLayer;
+
+		return m_NvrhiDevice;
+	}
+
+	[[nodiscard]] nvrhi::GraphicsAPI GetGraphicsAPI() const override
+	{
+		return nvrhi::GraphicsAPI::VULKAN;
+	}
+
+	void ReportLiveObjects() override;
+
+protected:
+	bool CreateDeviceAndSwapChain() override;
+	bool CreateDeviceOnly() override;
+	bool CreateWindowSurfaceAndSwapChain() override;
+	void DestroyDeviceAndSwapChain() override;
+
+	bool VSyncChangeRequiresResize( bool vsyncEnabled ) const override;
+
+	void ResizeSwapChain() override
+	{
+		// no surface to create a swap chain for yet, see AttachWindowSurface
+		if ( m_VulkanDevice && (m_WindowSurface || m_DeviceParams.headless) )
+		{
+			// the old swap chain is handed over to the new one and retired, no need to wait here
+			createSwapChain();
+		}
+	}
+
+	nvrhi::ITexture* GetCurrentBackBuffer() override
+	{
+		return m_SwapChainImages[m_SwapChainIndex].rhiHandle;
+	}
+	nvrhi::ITexture* GetBackBuffer( uint32_t index ) override
+	{
+		if ( index < m_SwapChainImages.size() )
+			return m_SwapChainImages[index].rhiHandle;
+		return nullptr;
+	}
+	uint32_t GetCurrentBackBufferIndex() override
+	{
+		return m_SwapChainIndex;
+	}
+	uint32_t GetBackBufferCount() override
+	{
+		return uint32_t( m_SwapChainImages.size() );
+	}
+
+	void BeginFrame() override;
+	void Present() override;
+
+	const char* GetRendererString() const override
+	{
+		return m_RendererString.c_str();
+	}
+
+	bool IsPresentWaitEnabled() const override
+	{
+		return m_PresentWaitSupported;
+	}
+
+	uint64_t GetCurrentFrameValue() const override
+	{
+		return m_FrameValue;
+	}
+
+	uint64_t GetCompletedFrameValue() const override
+	{
+		uint64_t value = 0;
+		if ( m_FrameSemaphore )
+		{
+			const vk::Result res = m_VulkanDevice.getSemaphoreCounterValue( m_FrameSemaphore, &value );
+			assert( res == vk::Result::eSuccess );
+		}
+
+		return value;
+	}
+
+	bool IsVulkanInstanceExtensionEnabled( const char* extensionName ) const override
+	{
+		return enabledExtensions.instance.contains( extensionName );
+	}
+
+	bool IsVulkanInstanceExtensionEnabled( VulkanInstanceExtensions::Type extension ) const override
+	{
+		return enabledExtensions.instance.contains( extension );
+	}
+
+	bool IsVulkanDeviceExtensionEnabled( const char* extensionName ) const override
+	{
+		return enabledExtensions.device.contains( extensionName );
+	}
+
+	bool IsVulkanDeviceExtensionEnabled( VulkanDeviceExtensions::Type extension ) const override
+	{
+		return enabledExtensions.device.contains( extension );
+	}
+
+	bool IsVulkanLayerEnabled( const char* layerName ) const override
+	{
+		return enabledExtensions.layers.find( layerName ) != enabledExtensions.layers.end();
+	}
+
+	void GetEnabledVulkanInstanceExtensions( std::vector<std::string>& extensions ) const override
+	{
+		for ( const char* ext : enabledExtensions.instance.names() )
+			extensions.push_back( ext );
+	}
+
+	void GetEnabledVulkanDeviceExtensions( std::vector<std::string>& extensions ) const override
+	{
+		for ( const char* ext : enabledExtensions.device.names() )
+			extensions.push_back( ext );
+	}
+
+	void GetEnabledVulkanLayers( std::vector<std::string>& layers ) const override
+	{
+		for ( const auto& ext : enabledExtensions.layers )
+			layers.push_back( ext );
+	}
+
+	bool SavePipelineCache() override;
+
+	nvrhi::Object GetVulkanPipelineCache() const override
+	{
+		return VkPipelineCache( m_PipelineCache );
+	}
+
+private:
+	bool createDeviceObjects( bool withSurface );
+	bool createInstance();
+	bool createWindowSurface();
+	void installDebugCallback();
+	void onValidationMessage( VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types,
+		const VkDebugUtilsMessengerCallbackDataEXT& data );
+	void flushValidationMessages();
+	bool pickPhysicalDevice();
+	bool scanPhysicalDevices( const std::vector<vk::PhysicalDevice>& devices );
+	bool checkPhysicalDevice( const vk::PhysicalDevice& physicalDevice, std::stringstream& errorStream );
+
+	// What tells the physical devices apart, read with one getProperties2 call per device
+	struct PhysicalDeviceIdentity
+	{
+		vk::PhysicalDevice device;
+		vk::PhysicalDeviceProperties properties;
+		vk::PhysicalDeviceIDProperties ids;
+	};
+
+	uint64_t getDeviceSelectionFingerprint( const std::vector<PhysicalDeviceIdentity>& identities ) const;
+	vk::PhysicalDevice loadDeviceSelection( const std::vector<PhysicalDeviceIdentity>& identities, uint64_t fingerprint );
+	void saveDeviceSelection( uint64_t fingerprint );
+	bool checkSurfaceSupport( const vk::PhysicalDevice& physicalDevice, std::stringstream& errorStream ) const;
+	bool findQueueFamilies( vk::PhysicalDevice physicalDevice );
+	bool createDevice();
+	void createPipelineCache();
+	bool createSwapChain();
+	bool createOffscreenImages();
+	void destroySwapChain();
+	void retireSwapChain();
+	void releaseRetiredSwapChains( uint64_t completedFrameValue );
+	bool presentsCompleted( const std::vector<SwapChainImage>& images ) const;
+	PresentModes::Type choosePresentMode( bool vsyncEnabled ) const;
+	void waitForFrameValue( uint64_t frameValue );
+	void waitForQueuedPresents();
+	void presentSwapChainImage();
+	bool getPhysicalDevicePresentationSupport( vk::PhysicalDevice& physicalDevice, int queueFamilyIndex );
+
+	struct VulkanExtensionSet
+	{
+		ExtensionSet<VulkanInstanceExtensions> instance;
+		std::unordered_set<std::string> layers;
+		ExtensionSet<VulkanDeviceExtensions> device;
+	};
+
+	// minimal set of required extensions
+	VulkanExtensionSet enabledExtensions = {
+		// instance
+		{
+			VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
+		},
+		// layers
+		{ },
+		// device
+		{
+			VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+			VK_KHR_MAINTENANCE1_EXTENSION_NAME
+		},
+	};
+
+	// optional extensions
+	VulkanExtensionSet optionalExtensions = {
+		// instance
+		{
+			VK_EXT_SAMPLER_FILTER_MINMAX_EXTENSION_NAME,
+			VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#ifdef VK_EXT_swapchain_maintenance1
+			VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME,
+			VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME
+#endif
+		},
+		// layers
+		{ },
+		// device
+		{
+			VK_EXT_DEBUG_MARKER_EXTENSION_NAME,
+			VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+			VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+			VK_NV_MESH_SHADER_EXTENSION_NAME,
+			VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME,
+#ifdef VK_EXT_swapchain_maintenance1
+			VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME
+#endif
+		},
+	};
+
+	ExtensionSet<VulkanDeviceExtensions> m_RayTracingExtensions = {
+		VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+		VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
+		VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+		VK_KHR_RAY_QUERY_EXTENSION_NAME,
+		VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME
+	};
+
+	std::string m_RendererString;
+
+	// first line of the device selection cache, bump when the fingerprint changes
+	static constexpr const char* DeviceSelectionCacheVersion = "elegy-rhi device selection 1";
+
+	vk::Instance m_VulkanInstance;
+	// the apiVersion the instance was created with
+	uint32_t m_InstanceApiVersion = VK_API_VERSION_1_2;
+	vk::DebugUtilsMessengerEXT m_DebugMessenger;
+
+	// Filled in before the messenger is installed and only read afterwards,
+	// so validation messages can be checked against them without locking
+	std::unordered_set<int32_t> m_IgnoredMessageIds;
+	// HashMessageName of each ignored name
+	std::unordered_set<uint64_t> m_IgnoredMessageNames;
+
+	struct ValidationMessageCounter
+	{
+		int32_t id = 0;
+		std::string name;
+		// repeats since the last flushValidationMessages
+		uint32_t pendingCount = 0;
+		uint64_t totalCount = 0;
+		// came up again since the current window started
+		bool seenInWindow = true;
+	};
+
+	// Messages that didn't come up for this many flushValidationMessages calls (i.e. frames) are forgotten,
+	// so the next one is reported in full again
+	static constexpr uint32_t ValidationWindowFrames = 120;
+	// past this many distinct messages in one window, new ones are reported without deduplication
+	static constexpr size_t MaxValidationCounters = 4096;
+
+	// keyed by messageIdNumber hashed with the objects the message is about, the callback may come from any thread
+	std::mutex m_ValidationMutex;
+	std::unordered_map<uint64_t, ValidationMessageCounter> m_ValidationCounters;
+	std::atomic<bool> m_ValidationRepeatsPending{ false };
+	// only touched by the thread that presents
+	uint32_t m_ValidationFlushCount = 0;
+
+	// Only with DeviceCreationParameters::vulkanHostAllocationCallbacks, otherwise m_AllocationCallbacks
+	// is null and the driver uses its own allocator. Every create and destroy call has to pass the same one
+	std::unique_ptr<VulkanHostAllocator> m_HostAllocator;
+	const vk::AllocationCallbacks* m_AllocationCallbacks = nullptr;
+
+	vk::PhysicalDevice m_VulkanPhysicalDevice;
+	int m_GraphicsQueueFamily = -1;
+	int m_ComputeQueueFamily = -1;
+	int m_TransferQueueFamily = -1;
+	int m_PresentQueueFamily = -1;
+
+	vk::Device m_VulkanDevice;
+	vk::Queue m_GraphicsQueue;
+	vk::Queue m_ComputeQueue;
+	vk::Queue m_TransferQueue;
+	vk::Queue m_PresentQueue;
+
+	vk::PipelineCache m_PipelineCache;
+	// empty if DeviceCreationParameters::pipelineCachePath isn't set
+	std::string m_PipelineCacheFile;
+
+	vk::SurfaceKHR m_WindowSurface;
+
+	vk::SurfaceFormatKHR m_SwapChainFormat;
+	vk::SwapchainKHR m_SwapChain;
+	// present modes supported by the window surface on the picked device
+	std::vector<vk::PresentModeKHR> m_SurfacePresentModes;
+
+	// VK_EXT_swapchain_maintenance1 lets us switch between the present modes
+	// below on every present, instead of recreating the swap chain
+	bool m_SwapChainMaintenance1Supported = false;
+	std::vector<vk::PresentModeKHR> m_SwapChainPresentModes;
+	// the vsync state m_PresentMode was chosen for
+	bool m_PresentModeVSync = false;
+
+	// VK_KHR_present_id + VK_KHR_present_wait, frames are presented with their frame value as the ID
+	bool m_PresentWaitSupported = false;
+	// present IDs below this one went to an older swap chain
+	uint64_t m_SwapChainFirstPresentId = 1;
+
+	struct SwapChainImage
+	{
+		vk::Image image;
+		nvrhi::TextureHandle rhiHandle;
+		// signalled when rendering to this image is done, waited on by presentKHR
+		vk::Semaphore renderCompleteSemaphore;
+		// with VK_EXT_swapchain_maintenance1, signalled once the presentation engine is done with the last present
+		vk::Fence presentFence;
+		bool presentFencePending = false;
+		// present fences that didn't signal in time, they can't be reset while pending so they're only
+		// destroyed along with the image
+		std::vector<vk::Fence> abandonedPresentFences;
+	};
+
+	std::vector<SwapChainImage> m_SwapChainImages;
+	uint32_t m_SwapChainIndex = uint32_t( -1 );
+
+	// Swap chains replaced during a resize, destroyed once the GPU is done with their last frame
+	struct RetiredSwapChain
+	{
+		vk::SwapchainKHR swapChain;
+		std::vector<SwapChainImage> images;
+		uint64_t frameValue = 0;
+	};
+
+	std::vector<RetiredSwapChain> m_RetiredSwapChains;
+
+	nvrhi::vulkan::DeviceHandle m_NvrhiDevice;
+	nvrhi::DeviceHandle m_ValidationLayer;
+
+	nvrhi::CommandListHandle m_BarrierCommandList;
+
+	// One acquire semaphore per frame in flight (plus one for the frame being recorded),
+	// a slot is only reused once the frame that waited on it has completed
+	std::vector<vk::Semaphore> m_AcquireSemaphores;
+	uint32_t m_AcquireSemaphoreIndex = 0;
+
+	// Timeline semaphore signalled on the graphics queue at the end of every frame,
+	// with the value of that frame. Frame values start at 1, 0 means "nothing submitted yet"
+	vk::Semaphore m_FrameSemaphore;
+	uint64_t m_FrameValue = 0;
+
+private:
+	static VKAPI_ATTR VkBool32 VKAPI_CALL vulkanDebugCallback(
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT types,
+		const VkDebugUtilsMessengerCallbackDataEXT* callbackData,
+		void* userData )
+	{
+		DeviceManager_VK* manager = static_cast<DeviceManager_VK*>( userData );
+
+		if ( manager && callbackData )
+		{
+			manager->onValidationMessage( severity, types, *callbackData );
+		}
+
+		return VK_FALSE;
+	}
+
+};
+
+static std::vector<const char*> stringSetToVector( const std::unordered_set<std::string>& set )
+{
+	std::vector<const char*> ret;
+	for ( const auto& s : set )
+	{
+		ret.push_back( s.c_str() );
+	}
+
+	return ret;
+}
+
+template <typename T>
+static std::vector<T> setToVector( const std::unordered_set<T>& set )
+{
+	std::vector<T> ret;
+	for ( const auto& s : set )
+	{
+		ret.push_back( s );
+	}
+
+	return ret;
+}
+
+bool DeviceManager_VK::createInstance()
+{
+	// add instance extensions requested by the user
+	for ( const std::string& name : m_DeviceParams.requiredVulkanInstanceExtensions )
+	{
+		enabledExtensions.instance.insert( name );
+	}
+	for ( const std::string& name : m_DeviceParams.optionalVulkanInstanceExtensions )
+	{
+		optionalExtensions.instance.insert( name );
+	}
+
+	// add layers requested by the user
+	for ( const std::string& name : m_DeviceParams.requiredVulkanLayers )
+	{
+		enabledExtensions.layers.insert( name );
+	}
+	for ( const std::string& name : m_DeviceParams.optionalVulkanLayers )
+	{
+		optionalExtensions.layers.insert( name );
+	}
+
+	ExtensionSet<VulkanInstanceExtensions> requiredExtensions = enabledExtensions.instance;
+
+	// figure out which optional extensions are supported
+	for ( const auto& instanceExt : vk::enumerateInstanceExtensionProperties() )
+	{
+		const std::string name = instanceExt.extensionName;
+		if ( optionalExtensions.instance.contains( name ) )
+		{
+			enabledExtensions.instance.insert( name );
+		}
+
+		requiredExtensions.erase( name );
+	}
+
+	if ( !requiredExtensions.empty() )
+	{
+		std::stringstream ss;
+		ss << "Cannot create a Vulkan instance because the following required extension(s) are not supported:";
+		for ( const char* ext : requiredExtensions.names() )
+			ss << std::endl << "  - " << ext;
+
+		Error( ss.str().c_str() );
+		return false;
+	}
+
+	Message( "Enabled Vulkan instance extensions:", m_DeviceParams.infoLogSeverity );
+	for ( const char* ext : enabledExtensions.instance.names() )
+	{
+		Log( m_DeviceParams.infoLogSeverity, "    %s", ext );
+	}
+
+	std::unordered_set<std::string> requiredLayers = enabledExtensions.layers;
+
+	for ( const auto& layer : vk::enumerateInstanceLayerProperties() )
+	{
+		const std::string name = layer.layerName;
+		if ( optionalExtensions.layers.find( name ) != optionalExtensions.layers.end() )
+		{
+			enabledExtensions.layers.insert( name );
+		}
+
+		requiredLayers.erase( name );
+	}
+
+	if ( !requiredLayers.empty() )
+	{
+		std::stringstream ss;
+		ss << "Cannot create a Vulkan instance because the following required layer(s) are not supported:";
+		for ( const auto& ext : requiredLayers )
+			ss << std::endl << "  - " << ext;
+
+		Error( ss.str().c_str() );
+		return false;
+	}
+
+	Message( "Enabled Vulkan layers:", m_DeviceParams.infoLogSeverity );
+	for ( const auto& layer : enabledExtensions.layers )
+	{
+		Log( m_DeviceParams.infoLogSeverity, "    %s", layer.c_str() );
+	}
+
+#ifdef VK_EXT_layer_settings
+	// See DeviceCreationParameters::vulkanValidationChecks. Only set when asked to, so the layer's
+	// own settings (vkconfig, vk_layer_settings.txt) aren't overridden for nothing
+	static constexpr std::pair<const char*, uint32_t> ValidationCheckSettings[] =
+	{
+		{ "validate_core", VulkanValidationChecks::Core },
+		{ "stateless_param", VulkanValidationChecks::Stateless },
+		{ "object_lifetime", VulkanValidationChecks::ObjectLifetime },
+		{ "thread_safety", VulkanValidationChecks::ThreadSafety },
+		{ "check_shaders", VulkanValidationChecks::Shaders },
+		{ "validate_sync", VulkanValidationChecks::Synchronization },
+		{ "validate_best_practices", VulkanValidationChecks::BestPractices },
+		{ "gpuav_enable", VulkanValidationChecks::GpuAssisted },
+	};
+
+	std::array<VkBool32, std::size( ValidationCheckSettings )> validationCheckValues{};
+	std::vector<VkLayerSettingEXT> validationSettings;
+
+	const std::string validationLayerName = "VK_LAYER_KHRONOS_validation";
+	if ( m_DeviceParams.vulkanValidationChecks != VulkanValidationChecks::Default && enabledExtensions.layers.count( validationLayerName ) )
+	{
+		// the extension comes with the layer, so it only shows up in the layer's own list
+		bool layerSettingsSupported = false;
+		for ( const auto& layerExt : vk::enumerateInstanceExtensionProperties( validationLayerName ) )
+		{
+			layerSettingsSupported |= strcmp( layerExt.extensionName, VK_EXT_LAYER_SETTINGS_EXTENSION_NAME ) == 0;
+		}
+
+		if ( layerSettingsSupported )
+		{
+			enabledExtensions.instance.insert( VK_EXT_LAYER_SETTINGS_EXTENSION_NAME );
+
+			for ( size_t i = 0; i < validationCheckValues.size(); i++ )
+			{
+				validationCheckValues[i] = (m_DeviceParams.vulkanValidationChecks & ValidationCheckSettings[i].second) ? VK_TRUE : VK_FALSE;
+				validationSettings.push_back( { "VK_LAYER_KHRONOS_validation", ValidationCheckSettings[i].first,
+					VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &validationCheckValues[i] } );
+			}
+		}
+		else
+		{
+			Message( "The Vulkan validation layer doesn't support VK_EXT_layer_settings, vulkanValidationChecks is ignored",
+				nvrhi::MessageSeverity::Warning );
+		}
+	}
+
+	VkLayerSettingsCreateInfoEXT layerSettingsInfo{ VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT };
+	layerSettingsInfo.settingCount = uint32_t( validationSettings.size() );
+	layerSettingsInfo.pSettings = validationSettings.data();
+#endif
+
+	auto instanceExtVec = enabledExtensions.instance.names();
+	auto layerVec = stringSetToVector( enabledExtensions.layers );
+
+	// Ask for the newest version we know how to use, each device then gets the lower of that and its own
+#ifdef VK_API_VERSION_1_3
+	m_InstanceApiVersion = VK_API_VERSION_1_3;
+#else
+	m_InstanceApiVersion = VK_API_VERSION_1_2;
+#endif
+
+	uint32_t loaderApiVersion = VK_API_VERSION_1_0;
+	if ( VULKAN_HPP_DEFAULT_DISPATCHER.vkEnumerateInstanceVersion )
+	{
+		VULKAN_HPP_DEFAULT_DISPATCHER.vkEnumerateInstanceVersion( &loaderApiVersion );
+	}
+	if ( loaderApiVersion < m_InstanceApiVersion )
+	{
+		// a 1.2 instance is the least we can work with
+		m_InstanceApiVersion = VK_API_VERSION_1_2;
+	}
+
+	auto applicationInfo = vk::ApplicationInfo()
+		.setApiVersion( m_InstanceApiVersion );
+
+	// create the vulkan instance
+	vk::InstanceCreateInfo info = vk::InstanceCreateInfo()
+		.setEnabledLayerCount( uint32_t( layerVec.size() ) )
+		.setPpEnabledLayerNames( layerVec.data() )
+		.setEnabledExtensionCount( uint32_t( instanceExtVec.size() ) )
+		.setPpEnabledExtensionNames( instanceExtVec.data() )
+		.setPApplicationInfo( &applicationInfo );
+
+#ifdef VK_EXT_layer_settings
+	if ( layerSettingsInfo.settingCount > 0 )
+	{
+		info.setPNext( &layerSettingsInfo );
+	}
+#endif
+
+	const vk::Result res = vk::createInstance( &info, m_AllocationCallbacks, &m_VulkanInstance );
+	if ( res != vk::Result::eSuccess )
+	{
+		Log( nvrhi::MessageSeverity::Error, "Failed to create a Vulkan instance, error code = %s", nvrhi::vulkan::resultToString( res ) );
+		return false;
+	}
+
+	VULKAN_HPP_DEFAULT_DISPATCHER.init( m_VulkanInstance );
+
+	return true;
+}
+
+// FNV-1a, for message names and the device selection fingerprint. Neither has to resist anyone
+static constexpr uint64_t HashSeed = 0xcbf29ce484222325ull;
+
+static void HashBytes( uint64_t& hash, const void* data, size_t size )
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>( data );
+	for ( size_t i = 0; i < size; i++ )
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+}
+
+template<typename T>
+static void HashValue( uint64_t& hash, const T& value )
+{
+	HashBytes( hash, &value, sizeof( value ) );
+}
+
+// for looking up message names without building a std::string first
+static uint64_t HashMessageName( const char* name )
+{
+	uint64_t hash = HashSeed;
+	HashBytes( hash, name, strlen( name ) );
+	return hash;
+}
+
+void DeviceManager_VK::installDebugCallback()
+{
+	m_IgnoredMessageIds.clear();
+	m_IgnoredMessageNames.clear();
+
+	for ( const int32_t id : m_DeviceParams.ignoredVulkanValidationMessageIds )
+	{
+		m_IgnoredMessageIds.insert( id );
+	}
+	for ( const size_t location : m_DeviceParams.ignoredVulkanValidationMessageLocations )
+	{
+		m_IgnoredMessageIds.insert( int32_t( location ) );
+	}
+	for ( const std::string& name : m_DeviceParams.ignoredVulkanValidationMessageNames )
+	{
+		m_IgnoredMessageNames.insert( HashMessageName( name.c_str() ) );
+	}
+
+	// Set up through the C API, Vulkan-Hpp keeps changing the callback's signature
+	VkDebugUtilsMessengerCreateInfoEXT info{ VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT };
+	info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
+		| VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+	info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
+		| VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
+		| VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	info.pfnUserCallback = vulkanDebugCallback;
+	info.pUserData = this;
+
+	VkDebugUtilsMessengerEXT messenger = VK_NULL_HANDLE;
+	const VkResult res = VULKAN_HPP_DEFAULT_DISPATCHER.vkCreateDebugUtilsMessengerEXT( static_cast<VkInstance>( m_VulkanInstance ), &info,
+		reinterpret_cast<const VkAllocationCallbacks*>( m_AllocationCallbacks ), &messenger );
+	assert( res == VK_SUCCESS );
+
+	m_DebugMessenger = messenger;
+}
+
+void DeviceManager_VK::onValidationMessage( VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types,
+	const VkDebugUtilsMessengerCallbackDataEXT& data )
+{
+	// Ignored and unsampled messages are rejected before anything is copied or formatted. Errors are never sampled away
+	if ( !IsValidationReportFrame() && !(severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) )
+		return;
+
+	const int32_t id = data.messageIdNumber;
+
+	if ( m_IgnoredMessageIds.count( id ) )
+		return;
+	if ( data.pMessageIdName && !m_IgnoredMessageNames.empty() && m_IgnoredMessageNames.count( HashMessageName( data.pMessageIdName ) ) )
+		return;
+
+	// Messages without an ID can't be told apart, so they are never deduplicated. The same VUID about
+	// different objects is a different problem, so those are reported separately
+	if ( id != 0 )
+	{
+		uint64_t key = HashSeed;
+		HashValue( key, id );
+		for ( uint32_t i = 0; i < data.objectCount; i++ )
+		{
+			HashValue( key, data.pObjects[i].objectType );
+			HashValue( key, data.pObjects[i].objectHandle );
+		}
+
+		std::lock_guard<std::mutex> lock( m_ValidationMutex );
+
+		auto it = m_ValidationCounters.find( key );
+		if ( it != m_ValidationCounters.end() )
+		{
+			it->second.totalCount++;
+			it->second.pendingCount++;
+			it->second.seenInWindow = true;
+			m_ValidationRepeatsPending.store( true, std::memory_order_relaxed );
+			return;
+		}
+
+		if ( m_ValidationCounters.size() < MaxValidationCounters )
+		{
+			ValidationMessageCounter& counter = m_ValidationCounters[key];
+			counter.id = id;
+			counter.name = data.pMessageIdName ? data.pMessageIdName : "";
+			counter.totalCount = 1;
+		}
+	}
+
+	const char* kind = (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) ? "error"
+		: (types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) ? "performance warning"
+		: "warning";
+
+	// Vulkan stuff is super wordy
+	Log( nvrhi::MessageSeverity::Warning, "[Vulkan %s: %s (0x%08x)] %s", kind,
+		data.pMessageIdName ? data.pMessageIdName : "", uint32_t( id ), data.pMessage ? data.pMessage : "" );
+}
+
+void DeviceManager_VK::flushValidationMessages()
+{
+	const bool windowEnded = ++m_ValidationFlushCount % ValidationWindowFrames == 0;
+	if ( !m_ValidationRepeatsPending.exchange( false, std::memory_order_relaxed ) && !windowEnded )
+		return;
+
+	std::lock_guard<std::mutex> lock( m_ValidationMutex );
+
+	auto it = m_ValidationCounters.begin();
+	while ( it != m_ValidationCounters.end() )
+	{
+		ValidationMessageCounter& counter = it->second;
+		if ( counter.pendingCount > 0 )
+		{
+			Log( nvrhi::MessageSeverity::Warning, "[Vulkan: %s (0x%08x)] suppressed %u repeats since the last report, %llu in total",
+				counter.name, uint32_t( counter.id ), counter.pendingCount, counter.totalCount );
+			counter.pendingCount = 0;
+		}
+
+		if ( windowEnded )
+		{
+			if ( !counter.seenInWindow )
+			{
+				it = m_ValidationCounters.erase( it );
+				continue;
+			}
+
+			counter.seenInWindow = false;
+		}
+
+		++it;
+	}
+}
+
+// Appends the reasons to errorStream if the device can't create our swap chain on the window surface
+bool DeviceManager_VK::checkSurfaceSupport( const vk::PhysicalDevice& physicalDevice, std::stringstream& errorStream ) const
+{
+	vk::Format requestedFormat = nvrhi::vulkan::convertFormat( m_DeviceParams.swapChainFormat );
+	vk::Extent2D requestedExtent( m_DeviceParams.backBufferWidth, m_DeviceParams.backBufferHeight );
+
+	bool supported = true;
+
+	auto surfaceCaps = physicalDevice.getSurfaceCapabilitiesKHR( m_WindowSurface );
+	auto surfaceFmts = physicalDevice.getSurfaceFormatsKHR( m_WindowSurface );
+
+	if ( surfaceCaps.minImageCount > m_DeviceParams.swapChainBufferCount ||
+		(surfaceCaps.maxImageCount < m_DeviceParams.swapChainBufferCount && surfaceCaps.maxImageCount > 0) )
+	{
+		errorStream << std::endl << "  - cannot support the requested swap chain image count:";
+		errorStream << " requested " << m_DeviceParams.swapChainBufferCount << ", available " << surfaceCaps.minImageCount << " - " << surfaceCaps.maxImageCount;
+		supported = false;
+	}
+
+	if ( surfaceCaps.minImageExtent.width > requestedExtent.width ||
+		surfaceCaps.minImageExtent.height > requestedExtent.height ||
+		surfaceCaps.maxImageExtent.width < requestedExtent.width ||
+		surfaceCaps.maxImageExtent.height < requestedExtent.height )
+	{
+		errorStream << std::endl << "  - cannot support the requested swap chain size:";
+		errorStream << " requested " << requestedExtent.width << "x" << requestedExtent.height << ", ";
+		errorStream << " available " << surfaceCaps.minImageExtent.width << "x" << surfaceCaps.minImageExtent.height;
+		errorStream << " - " << surfaceCaps.maxImageExtent.width << "x" << surfaceCaps.maxImageExtent.height;
+		supported = false;
+	}
+
+	bool surfaceFormatPresent = false;
+	for ( const vk::SurfaceFormatKHR& surfaceFmt : surfaceFmts )
+	{
+		if ( surfaceFmt.format == requestedFormat )
+		{
+			surfaceFormatPresent = true;
+			break;
+		}
+	}
+
+	if ( !surfaceFormatPresent )
+	{
+		// can't create a swap chain using the format requested
+		errorStream << std::endl << "  - does not support the requested swap chain format";
+		supported = false;
+	}
+
+	return supported;
+}
+
+static std::string UuidToString( const uint8_t* uuid )
+{
+	std::string result;
+	for ( uint32_t i = 0; i < VK_UUID_SIZE; i++ )
+	{
+		result += va( "%02x", uuid[i] );
+	}
+
+	return result;
+}
+
+static vk::PhysicalDeviceIDProperties GetPhysicalDeviceIds( const vk::PhysicalDevice& physicalDevice )
+{
+	vk::PhysicalDeviceIDProperties idProperties;
+	auto properties = vk::PhysicalDeviceProperties2()
+		.setPNext( &idProperties );
+
+	physicalDevice.getProperties2( &properties );
+
+	return idProperties;
+}
+
+uint64_t DeviceManager_VK::getDeviceSelectionFingerprint( const std::vector<PhysicalDeviceIdentity>& identities ) const
+{
+	// The devices and drivers present...
+	uint64_t hash = HashSeed;
+	for ( const PhysicalDeviceIdentity& identity : identities )
+	{
+		HashValue( hash, identity.properties.vendorID );
+		HashValue( hash, identity.properties.deviceID );
+		HashValue( hash, identity.properties.driverVersion );
+		HashBytes( hash, identity.ids.deviceUUID.data(), VK_UUID_SIZE );
+		HashBytes( hash, identity.ids.driverUUID.data(), VK_UUID_SIZE );
+	}
+
+	// ...and everything the choice was validated against
+	std::vector<std::string> requiredExtensions;
+	for ( const char* ext : enabledExtensions.device.names() )
+		requiredExtensions.push_back( ext );
+	std::sort( requiredExtensions.begin(), requiredExtensions.end() );
+	for ( const std::string& ext : requiredExtensions )
+	{
+		HashBytes( hash, ext.c_str(), ext.size() + 1 );
+	}
+
+	HashValue( hash, bool( m_WindowSurface ) );
+	HashValue( hash, m_DeviceParams.swapChainFormat );
+	HashValue( hash, m_DeviceParams.swapChainBufferCount );
+	HashValue( hash, m_DeviceParams.enableComputeQueue );
+	HashValue( hash, m_DeviceParams.enableCopyQueue );
+
+	return hash;
+}
+
+vk::PhysicalDevice DeviceManager_VK::loadDeviceSelection( const std::vector<PhysicalDeviceIdentity>& identities, uint64_t fingerprint )
+{
+	std::ifstream file( m_DeviceParams.vulkanDeviceSelectionCachePath );
+	if ( !file )
+		return {};
+
+	std::string version, cachedFingerprint, cachedUuid;
+	std::getline( file, version );
+	file >> cachedFingerprint >> cachedUuid;
+
+	if ( version != DeviceSelectionCacheVersion || cachedFingerprint != va( "%016llx", (unsigned long long)fingerprint ) )
+		return {};
+
+	for ( const PhysicalDeviceIdentity& identity : identities )
+	{
+		if ( UuidToString( identity.ids.deviceUUID.data() ) != cachedUuid )
+			continue;
+
+		// The cache only saves checking all the other devices. This one goes through the same checks
+		// as in the full scan, so a different surface or a lost feature can't slip through
+		std::stringstream errorStream;
+		errorStream << "The cached Vulkan device " << identity.properties.deviceName.data() << " can't be used anymore:";
+
+		m_GraphicsQueueFamily = m_ComputeQueueFamily = m_TransferQueueFamily = m_PresentQueueFamily = -1;
+		if ( !checkPhysicalDevice( identity.device, errorStream ) )
+		{
+			Message( errorStream.str().c_str(), m_DeviceParams.infoLogSeverity );
+			return {};
+		}
+
+		return identity.device;
+	}
+
+	return {};
+}
+
+void DeviceManager_VK::saveDeviceSelection( uint64_t fingerprint )
+{
+	const vk::PhysicalDeviceIDProperties ids = GetPhysicalDeviceIds( m_VulkanPhysicalDevice );
+
+	std::string contents = DeviceSelectionCacheVersion;
+	contents += '\n';
+	contents += va( "%016llx\n", (unsigned long long)fingerprint );
+	contents += UuidToString( ids.deviceUUID.data() );
+	contents += '\n';
+	// not read back, but nice to have when looking at the file
+	contents += m_VulkanPhysicalDevice.getProperties().deviceName.data();
+	contents += '\n';
+
+	if ( !WriteFileAtomically( m_DeviceParams.vulkanDeviceSelectionCachePath, contents.data(), contents.size() ) )
+	{
+		Log( nvrhi::MessageSeverity::Warning, "Failed to write the device selection cache to %s", m_DeviceParams.vulkanDeviceSelectionCachePath );
+	}
+}
+
+bool DeviceManager_VK::pickPhysicalDevice()
+{
+	auto devices = m_VulkanInstance.enumeratePhysicalDevices();
+
+	// The full scan below checks every device's extensions, features, queues and surface support, which adds up
+	// on machines with several GPUs. If nothing changed since last time, only the same device gets checked
+	const bool useCache = !m_DeviceParams.vulkanDeviceSelectionCachePath.empty();
+
+	std::vector<PhysicalDeviceIdentity> identities;
+	if ( useCache )
+	{
+		identities.reserve( devices.size() );
+		for ( const auto& dev : devices )
+		{
+			PhysicalDeviceIdentity& identity = identities.emplace_back();
+			auto properties = vk::PhysicalDeviceProperties2()
+				.setPNext( &identity.ids );
+			dev.getProperties2( &properties );
+
+			identity.device = dev;
+			identity.properties = properties.properties;
+		}
+	}
+
+	const uint64_t fingerprint = useCache ? getDeviceSelectionFingerprint( identities ) : 0;
+
+	m_VulkanPhysicalDevice = useCache ? loadDeviceSelection( identities, fingerprint ) : vk::PhysicalDevice();
+	if ( m_VulkanPhysicalDevice )
+	{
+		Message( "Using the cached Vulkan device selection", m_DeviceParams.infoLogSeverity );
+	}
+	else
+	{
+		// loadDeviceSelection may have left the queue families of a device that didn't make it
+		m_GraphicsQueueFamily = m_ComputeQueueFamily = m_TransferQueueFamily = m_PresentQueueFamily = -1;
+
+		if ( !scanPhysicalDevices( devices ) )
+			return false;
+
+		if ( useCache )
+		{
+			saveDeviceSelection( fingerprint );
+		}
+	}
+
+	if ( m_WindowSurface )
+	{
+		m_SurfacePresentModes = m_VulkanPhysicalDevice.getSurfacePresentModesKHR( m_WindowSurface );
+	}
+
+	return true;
+}
+
+bool DeviceManager_VK::scanPhysicalDevices( const std::vector<vk::PhysicalDevice>& devices )
+{
+	// Start building an error message in case we cannot find a device.
+	std::stringstream errorStream;
+	errorStream << "Cannot find a Vulkan device that supports all the required extensions and properties.";
+
+	// build a list of GPUs
+	std::vector<vk::PhysicalDevice> discreteGPUs;
+	std::vector<vk::PhysicalDevice> otherGPUs;
+	for ( const auto& dev : devices )
+	{
+		auto prop = dev.getProperties();
+
+		errorStream << std::endl << prop.deviceName.data() << ":";
+
+		if ( !checkPhysicalDevice( dev, errorStream ) )
+			continue;
+
+		if ( prop.deviceType == vk::PhysicalDeviceType::eDiscreteGpu )
+		{
+			discreteGPUs.push_back( dev );
+		}
+		else {
+			otherGPUs.push_back( dev );
+		}
+	}
+
+	// pick the first discrete GPU if it exists, otherwise the first integrated GPU
+	if ( !discreteGPUs.empty() )
+	{
+		m_VulkanPhysicalDevice = discreteGPUs[0];
+	}
+	else if ( !otherGPUs.empty() )
+	{
+		m_VulkanPhysicalDevice = otherGPUs[0];
+	}
+	else
+	{
+		Error( errorStream.str().c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+// Appends the reasons to errorStream if the device doesn't have what we need
+bool DeviceManager_VK::checkPhysicalDevice( const vk::PhysicalDevice& physicalDevice, std::stringstream& errorStream )
+{
+	// check that all required device extensions are present
+	ExtensionSet<VulkanDeviceExtensions> requiredExtensions = enabledExtensions.device;
+	auto deviceExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+	for ( const auto& ext : deviceExtensions )
+	{
+		requiredExtensions.erase( std::string( ext.extensionName.data() ) );
+	}
+
+	bool deviceIsGood = true;
+
+	if ( !requiredExtensions.empty() )
+	{
+		// device is missing one or more required extensions
+		for ( const char* ext : requiredExtensions.names() )
+		{
+			errorStream << std::endl << "  - missing " << ext;
+		}
+		deviceIsGood = false;
+	}
+
+	auto deviceFeatures = physicalDevice.getFeatures();
+	if ( !deviceFeatures.samplerAnisotropy )
+	{
+		// device is a toaster oven
+		errorStream << std::endl << "  - does not support samplerAnisotropy";
+		deviceIsGood = false;
+	}
+	if ( !deviceFeatures.textureCompressionBC )
+	{
+		errorStream << std::endl << "  - does not support textureCompressionBC";
+		deviceIsGood = false;
+	}
+
+	// check that this device supports our intended swap chain creation parameters,
+	// a surface attached later on is checked against the picked device instead
+	if ( m_WindowSurface && !checkSurfaceSupport( physicalDevice, errorStream ) )
+	{
+		deviceIsGood = false;
+	}
+
+	if ( !findQueueFamilies( physicalDevice ) )
+	{
+		// device doesn't have all the queue families we need
+		errorStream << std::endl << "  - does not support the necessary queue types";
+		deviceIsGood = false;
+	}
+
+	// check that we can present from the graphics queue
+	if ( m_WindowSurface && !physicalDevice.getSurfaceSupportKHR( m_GraphicsQueueFamily, m_WindowSurface ) )
+	{
+		errorStream << std::endl << "  - cannot present";
+		deviceIsGood = false;
+	}
+
+	return deviceIsGood;
+}
+
+bool DeviceManager_VK::findQueueFamilies( vk::PhysicalDevice physicalDevice )
+{
+	auto props = physicalDevice.getQueueFamilyProperties();
+
+	Log( nvrhi::MessageSeverity::Info, "Physical device has %i queue families", props.size() );
+
+	for ( int i = 0; i < int( props.size() ); i++ )
+	{
+		const auto& queueFamily = props[i];
+
+		if ( m_GraphicsQueueFamily == -1 )
+		{
+			if ( queueFamily.queueCount > 0 &&
+				(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) )
+			{
+				m_GraphicsQueueFamily = i;
+			}
+		}
+
+		if ( m_ComputeQueueFamily == -1 )
+		{
+			if ( queueFamily.queueCount > 0 &&
+				(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) &&
+				!(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) )
+			{
+				m_ComputeQueueFamily = i;
+			}
+		}
+
+		if ( m_TransferQueueFamily == -1 )
+		{
+			if ( queueFamily.queueCount > 0 &&
+				(queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) &&
+				!(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) &&
+				!(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) )
+			{
+				m_TransferQueueFamily = i;
+			}
+		}
+
+		if ( m_PresentQueueFamily == -1 && m_WindowSurface )
+		{
+			if ( queueFamily.queueCount > 0 &&
+				getPhysicalDevicePresentationSupport( physicalDevice, i ) )
+			{
+				m_PresentQueueFamily = i;
+			}
+		}
+	}
+
+	// Nothing gets presented in headless mode, the "present" queue is just the graphics queue.
+	// Same for surfaces attached after device creation, which are checked against the graphics queue then
+	if ( !m_WindowSurface )
+	{
+		m_PresentQueueFamily = m_GraphicsQueueFamily;
+	}
+
+	if ( m_GraphicsQueueFamily == -1 ||
+		m_PresentQueueFamily == -1 ||
+		(m_ComputeQueueFamily == -1 && m_DeviceParams.enableComputeQueue) ||
+		(m_TransferQueueFamily == -1 && m_DeviceParams.enableCopyQueue) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceManager_VK::createDevice()
+{
+	// figure out which optional extensions are supported
+	auto deviceExtensions = m_VulkanPhysicalDevice.enumerateDeviceExtensionProperties();
+	for ( const auto& ext : deviceExtensions )
+	{
+		const std::string name = ext.extensionName;
+		if ( optionalExtensions.device.contains( name ) )
+		{
+			enabledExtensions.device.insert( name );
+		}
+
+		if ( m_DeviceParams.enableRayTracingExtensions && m_RayTracingExtensions.contains( name ) )
+		{
+			enabledExtensions.device.insert( name );
+		}
+	}
+
+#ifdef VK_EXT_swapchain_maintenance1
+	// the swap chain extension is useless without its surface counterpart on the instance
+	if ( !enabledExtensions.instance.contains( VulkanInstanceExtensions::SurfaceMaintenance1 ) )
+	{
+		enabledExtensions.device.erase( VulkanDeviceExtensions::SwapchainMaintenance1 );
+	}
+#endif
+
+	using Ext = VulkanDeviceExtensions;
+	const auto& enabled = enabledExtensions.device;
+	const bool accelStructSupported = enabled.contains( Ext::AccelerationStructure );
+	const bool bufferAddressSupported = enabled.contains( Ext::BufferDeviceAddress );
+	const bool rayPipelineSupported = enabled.contains( Ext::RayTracingPipeline );
+	const bool rayQuerySupported = enabled.contains( Ext::RayQuery );
+	const bool meshletsSupported = enabled.contains( Ext::MeshShaderNV );
+	const bool vrsSupported = enabled.contains( Ext::FragmentShadingRate );
+	const bool swapChainMaintenance1Supported = enabled.contains( Ext::SwapchainMaintenance1 );
+	const bool presentIdSupported = enabled.contains( Ext::PresentId );
+	const bool presentWaitSupported = enabled.contains( Ext::PresentWait );
+	const bool dynamicRenderingSupported = enabled.contains( Ext::DynamicRendering );
+
+	Message( "Enabled Vulkan device extensions:", m_DeviceParams.infoLogSeverity );
+	for ( const char* ext : enabled.names() )
+	{
+		Log( m_DeviceParams.infoLogSeverity, "    %s", ext );
+	}
+
+	std::unordered_set<int> uniqueQueueFamilies = {
+		m_GraphicsQueueFamily,
+		m_PresentQueueFamily };
+
+	if ( m_DeviceParams.enableComputeQueue )
+		uniqueQueueFamilies.insert( m_ComputeQueueFamily );
+
+	if ( m_DeviceParams.enableCopyQueue )
+		uniqueQueueFamilies.insert( m_TransferQueueFamily );
+
+	float priority = 1.f;
+	std::vector<vk::DeviceQueueCreateInfo> queueDesc;
+	for ( int queueFamily : uniqueQueueFamilies )
+	{
+		queueDesc.push_back( vk::DeviceQueueCreateInfo()
+			.setQueueFamilyIndex( queueFamily )
+			.setQueueCount( 1 )
+			.setPQueuePriorities( &priority ) );
+	}
+
+	// Ask the device what it supports, for every feature struct we might enable
+	const uint32_t deviceApiVersion = std::min( m_InstanceApiVersion, m_VulkanPhysicalDevice.getProperties().apiVersion );
+
+	vk::PhysicalDeviceVulkan12Features supported12;
+#ifdef VK_API_VERSION_1_3
+	vk::PhysicalDeviceVulkan13Features supported13;
+	const bool vulkan13Supported = deviceApiVersion >= VK_API_VERSION_1_3;
+#else
+	const bool vulkan13Supported = false;
+#endif
+#ifdef VK_KHR_dynamic_rendering
+	// the extension's struct can't be chained along with the 1.3 one
+	const bool dynamicRenderingExtSupported = dynamicRenderingSupported && !vulkan13Supported;
+	vk::PhysicalDeviceDynamicRenderingFeaturesKHR supportedDynamicRendering;
+#endif
+	vk::PhysicalDeviceAccelerationStructureFeaturesKHR supportedAccelStruct;
+	vk::PhysicalDeviceRayTracingPipelineFeaturesKHR supportedRayPipeline;
+	vk::PhysicalDeviceRayQueryFeaturesKHR supportedRayQuery;
+	vk::PhysicalDeviceMeshShaderFeaturesNV supportedMeshlets;
+	vk::PhysicalDeviceFragmentShadingRateFeaturesKHR supportedVrs;
+	vk::PhysicalDevicePresentIdFeaturesKHR supportedPresentId;
+	vk::PhysicalDevicePresentWaitFeaturesKHR supportedPresentWait;
+#ifdef VK_EXT_swapchain_maintenance1
+	vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT supportedSwapChainMaintenance1;
+#endif
+
+	void* pNext = nullptr;
+#define APPEND_EXTENSION(condition, desc) if (condition) { (desc).pNext = pNext; pNext = &(desc); }  // NOLINT(cppcoreguidelines-macro-usage)
+	APPEND_EXTENSION( true, supported12 )
+#ifdef VK_API_VERSION_1_3
+	APPEND_EXTENSION( vulkan13Supported, supported13 )
+#endif
+	APPEND_EXTENSION( accelStructSupported, supportedAccelStruct )
+	APPEND_EXTENSION( rayPipelineSupported, supportedRayPipeline )
+	APPEND_EXTENSION( rayQuerySupported, supportedRayQuery )
+	APPEND_EXTENSION( meshletsSupported, supportedMeshlets )
+	APPEND_EXTENSION( vrsSupported, supportedVrs )
+	APPEND_EXTENSION( presentIdSupported, supportedPresentId )
+	APPEND_EXTENSION( presentWaitSupported, supportedPresentWait )
+#ifdef VK_KHR_dynamic_rendering
+	APPEND_EXTENSION( dynamicRenderingExtSupported, supportedDynamicRendering )
+#endif
+#ifdef VK_EXT_swapchain_maintenance1
+	APPEND_EXTENSION( swapChainMaintenance1Supported, supportedSwapChainMaintenance1 )
+#endif
+
+	auto supportedFeatures = vk::PhysicalDeviceFeatures2()
+		.setPNext( pNext );
+	m_VulkanPhysicalDevice.getFeatures2( &supportedFeatures );
+
+	const vk::PhysicalDeviceFeatures& supportedCore = supportedFeatures.features;
+
+	// These are the only ones we can't do without, everything else is enabled if it's there
+	if ( !supportedCore.samplerAnisotropy || !supportedCore.textureCompressionBC || !supported12.timelineSemaphore )
+	{
+		Error( "The Vulkan device doesn't support samplerAnisotropy, textureCompressionBC or timelineSemaphore" );
+		return false;
+	}
+
+	auto deviceFeatures = vk::PhysicalDeviceFeatures()
+		.setShaderImageGatherExtended( supportedCore.shaderImageGatherExtended )
+		.setSamplerAnisotropy( true )
+		.setTessellationShader( supportedCore.tessellationShader )
+		.setTextureCompressionBC( true )
+		.setGeometryShader( supportedCore.geometryShader )
+		.setImageCubeArray( supportedCore.imageCubeArray )
+		.setDualSrcBlend( supportedCore.dualSrcBlend );
+
+	// The buffer device address feature lives in here since 1.2, chaining the extension's own struct next to it is invalid
+	auto vulkan12features = vk::PhysicalDeviceVulkan12Features()
+		.setDescriptorIndexing( supported12.descriptorIndexing )
+		.setRuntimeDescriptorArray( supported12.runtimeDescriptorArray )
+		.setDescriptorBindingPartiallyBound( supported12.descriptorBindingPartiallyBound )
+		.setDescriptorBindingVariableDescriptorCount( supported12.descriptorBindingVariableDescriptorCount )
+		.setTimelineSemaphore( true )
+		.setShaderSampledImageArrayNonUniformIndexing( supported12.shaderSampledImageArrayNonUniformIndexing )
+		.setBufferDeviceAddress( bufferAddressSupported && supported12.bufferDeviceAddress );
+
+#ifdef VK_API_VERSION_1_3
+	auto vulkan13features = vk::PhysicalDeviceVulkan13Features()
+		.setSynchronization2( supported13.synchronization2 )
+		.setMaintenance4( supported13.maintenance4 )
+		.setDynamicRendering( supported13.dynamicRendering );
+#endif
+
+	auto accelStructFeatures = vk::PhysicalDeviceAccelerationStructureFeaturesKHR()
+		.setAccelerationStructure( supportedAccelStruct.accelerationStructure );
+	auto rayPipelineFeatures = vk::PhysicalDeviceRayTracingPipelineFeaturesKHR()
+		.setRayTracingPipeline( supportedRayPipeline.rayTracingPipeline )
+		.setRayTraversalPrimitiveCulling( supportedRayPipeline.rayTraversalPrimitiveCulling );
+	auto rayQueryFeatures = vk::PhysicalDeviceRayQueryFeaturesKHR()
+		.setRayQuery( supportedRayQuery.rayQuery );
+	auto meshletFeatures = vk::PhysicalDeviceMeshShaderFeaturesNV()
+		.setTaskShader( supportedMeshlets.taskShader )
+		.setMeshShader( supportedMeshlets.meshShader );
+	auto vrsFeatures = vk::PhysicalDeviceFragmentShadingRateFeaturesKHR()
+		.setPipelineFragmentShadingRate( supportedVrs.pipelineFragmentShadingRate )
+		.setPrimitiveFragmentShadingRate( supportedVrs.primitiveFragmentShadingRate )
+		.setAttachmentFragmentShadingRate( supportedVrs.attachmentFragmentShadingRate );
+	auto presentIdFeatures = vk::PhysicalDevicePresentIdFeaturesKHR()
+		.setPresentId( supportedPresentId.presentId );
+	auto presentWaitFeatures = vk::PhysicalDevicePresentWaitFeaturesKHR()
+		.setPresentWait( supportedPresentWait.presentWait );
+#ifdef VK_KHR_dynamic_rendering
+	auto dynamicRenderingFeatures = vk::PhysicalDeviceDynamicRenderingFeaturesKHR()
+		.setDynamicRendering( supportedDynamicRendering.dynamicRendering );
+#endif
+#ifdef VK_EXT_swapchain_maintenance1
+	auto swapChainMaintenance1Features = vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT()
+		.setSwapchainMaintenance1( supportedSwapChainMaintenance1.swapchainMaintenance1 );
+#endif
+
+	pNext = nullptr;
+	APPEND_EXTENSION( true, vulkan12features )
+#ifdef VK_API_VERSION_1_3
+	APPEND_EXTENSION( vulkan13Supported, vulkan13features )
+#endif
+	APPEND_EXTENSION( accelStructSupported, accelStructFeatures )
+	APPEND_EXTENSION( rayPipelineSupported, rayPipelineFeatures )
+	APPEND_EXTENSION( rayQuerySupported, rayQueryFeatures )
+	APPEND_EXTENSION( meshletsSupported, meshletFeatures )
+	APPEND_EXTENSION( vrsSupported, vrsFeatures )
+	APPEND_EXTENSION( presentIdSupported, presentIdFeatures )
+	APPEND_EXTENSION( presentWaitSupported, presentWaitFeatures )
+#ifdef VK_KHR_dynamic_rendering
+	APPEND_EXTENSION( dynamicRenderingExtSupported, dynamicRenderingFeatures )
+#endif
+#ifdef VK_EXT_swapchain_maintenance1
+	APPEND_EXTENSION( swapChainMaintenance1Supported, swapChainMaintenance1Features )
+#endif
+#undef APPEND_EXTENSION
+
+	auto enabledFeatures = vk::PhysicalDeviceFeatures2()
+		.setFeatures( deviceFeatures )
+		.setPNext( pNext );
+
+	auto layerVec = stringSetToVector( enabledExtensions.layers );
+	auto extVec = enabledExtensions.device.names();
+
+	auto deviceDesc = vk::DeviceCreateInfo()
+		.setPQueueCreateInfos( queueDesc.data() )
+		.setQueueCreateInfoCount( uint32_t( queueDesc.size() ) )
+		.setEnabledExtensionCount( uint32_t( extVec.size() ) )
+		.setPpEnabledExtensionNames( extVec.data() )
+		.setEnabledLayerCount( uint32_t( layerVec.size() ) )
+		.setPpEnabledLayerNames( layerVec.data() )
+		.setPNext( &enabledFeatures );
+
+	//if ( m_DeviceParams.deviceCreateInfoCallback )
+	//	m_DeviceParams.deviceCreateInfoCallback( deviceDesc );
+
+	const vk::Result res = m_VulkanPhysicalDevice.createDevice( &deviceDesc, m_AllocationCallbacks, &m_VulkanDevice );
+	if ( res != vk::Result::eSuccess )
+	{
+		Log( nvrhi::MessageSeverity::Error, "Failed to create a Vulkan physical device, error code = %s", nvrhi::vulkan::resultToString( res ) );
+		return false;
+	}
+
+	m_VulkanDevice.getQueue( m_GraphicsQueueFamily, 0, &m_GraphicsQueue );
+	if ( m_DeviceParams.enableComputeQueue )
+		m_VulkanDevice.getQueue( m_ComputeQueueFamily, 0, &m_ComputeQueue );
+	if ( m_DeviceParams.enableCopyQueue )
+		m_VulkanDevice.getQueue( m_TransferQueueFamily, 0, &m_TransferQueue );
+	m_VulkanDevice.getQueue( m_PresentQueueFamily, 0, &m_PresentQueue );
+
+	VULKAN_HPP_DEFAULT_DISPATCHER.init( m_VulkanDevice );
+
+	m_DeviceCapabilities = DeviceCapabilities();
+	m_DeviceCapabilities.vulkanApiVersion = deviceApiVersion;
+	m_DeviceCapabilities.descriptorIndexing = vulkan12features.descriptorIndexing;
+	m_DeviceCapabilities.bufferDeviceAddress = vulkan12features.bufferDeviceAddress;
+	m_DeviceCapabilities.timelineSemaphore = true;
+#ifdef VK_API_VERSION_1_3
+	m_DeviceCapabilities.synchronization2 = vulkan13Supported && vulkan13features.synchronization2;
+	m_DeviceCapabilities.maintenance4 = vulkan13Supported && vulkan13features.maintenance4;
+	m_DeviceCapabilities.dynamicRendering = vulkan13Supported && vulkan13features.dynamicRendering;
+#endif
+#ifdef VK_KHR_dynamic_rendering
+	if ( dynamicRenderingExtSupported )
+	{
+		m_DeviceCapabilities.dynamicRendering = dynamicRenderingFeatures.dynamicRendering;
+	}
+#endif
+	m_DeviceCapabilities.accelerationStructure = accelStructSupported && accelStructFeatures.accelerationStructure;
+	m_DeviceCapabilities.rayTracingPipeline = rayPipelineSupported && rayPipelineFeatures.rayTracingPipeline;
+	m_DeviceCapabilities.rayQuery = rayQuerySupported && rayQueryFeatures.rayQuery;
+	m_DeviceCapabilities.meshShader = meshletsSupported && meshletFeatures.meshShader;
+	m_DeviceCapabilities.variableRateShading = vrsSupported && vrsFeatures.pipelineFragmentShadingRate;
+	// present wait is useless without present IDs to wait on
+	m_DeviceCapabilities.presentWait = presentIdSupported && presentIdFeatures.presentId
+		&& presentWaitSupported && presentWaitFeatures.presentWait;
+#ifdef VK_EXT_swapchain_maintenance1
+	m_DeviceCapabilities.swapChainMaintenance1 = swapChainMaintenance1Supported && swapChainMaintenance1Features.swapchainMaintenance1;
+#endif
+
+	m_SwapChainMaintenance1Supported = m_DeviceCapabilities.swapChainMaintenance1;
+	m_PresentWaitSupported = m_DeviceCapabilities.presentWait;
+
+	// stash the renderer string
+	auto prop = m_VulkanPhysicalDevice.getProperties();
+	m_RendererString = std::string( prop.deviceName.data() );
+
+	Log( m_DeviceParams.infoLogSeverity, "Created Vulkan device: %s", m_RendererString.c_str() );
+
+	return true;
+}
+
+// The blob starts with a VkPipelineCacheHeaderVersionOne, drivers are supposed to reject foreign data
+// themselves, but some have been known to crash on it instead
+static bool IsPipelineCacheCompatible( const void* data, size_t size, const vk::PhysicalDeviceProperties& properties )
+{
+	VkPipelineCacheHeaderVersionOne header{};
+	if ( size < sizeof( header ) )
+		return false;
+
+	std::memcpy( &header, data, sizeof( header ) );
+
+	return header.headerSize >= sizeof( header )
+		&& header.headerSize <= size
+		&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header.vendorID == properties.vendorID
+		&& header.deviceID == properties.deviceID
+		&& std::memcmp( header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE ) == 0;
+}
+
+void DeviceManager_VK::createPipelineCache()
+{
+	MappedFile cacheFile;
+
+	if ( !m_DeviceParams.pipelineCachePath.empty() )
+	{
+		// The header doesn't say anything about the driver version, so put it in the name,
+		// an updated driver simply starts over with a new file
+		const vk::PhysicalDeviceProperties properties = m_VulkanPhysicalDevice.getProperties();
+
+		std::string uuid;
+		for ( uint8_t byte : properties.pipelineCacheUUID )
+		{
+			uuid += va( "%02x", byte );
+		}
+
+		const std::string fileName = va( "pipelines-%04x-%04x-%08x-%s.bin",
+			properties.vendorID, properties.deviceID, properties.driverVersion, uuid.c_str() );
+		m_PipelineCacheFile = (std::filesystem::path( m_DeviceParams.pipelineCachePath ) / fileName).string();
+
+		if ( cacheFile.Open( m_PipelineCacheFile )
+			&& !IsPipelineCacheCompatible( cacheFile.GetData(), cacheFile.GetSize(), properties ) )
+		{
+			Log( nvrhi::MessageSeverity::Warning, "Ignoring incompatible pipeline cache %s", m_PipelineCacheFile.c_str() );
+			cacheFile.Close();
+		}
+	}
+
+	// the driver reads straight from the mapping
+	auto cacheInfo = vk::PipelineCacheCreateInfo()
+		.setInitialDataSize( cacheFile.GetSize() )
+		.setPInitialData( cacheFile.GetData() );
+
+	vk::Result res = m_VulkanDevice.createPipelineCache( &cacheInfo, m_AllocationCallbacks, &m_PipelineCache );
+	if ( res != vk::Result::eSuccess && cacheFile.GetSize() > 0 )
+	{
+		Log( nvrhi::MessageSeverity::Warning, "Failed to load pipeline cache %s, starting with an empty one", m_PipelineCacheFile.c_str() );
+
+		cacheInfo = vk::PipelineCacheCreateInfo();
+		res = m_VulkanDevice.createPipelineCache( &cacheInfo, m_AllocationCallbacks, &m_PipelineCache );
+	}
+
+	if ( res != vk::Result::eSuccess )
+	{
+		// not fatal, pipelines just won't be cached
+		Log( nvrhi::MessageSeverity::Warning, "Failed to create a pipeline cache, error code = %s", nvrhi::vulkan::resultToString( res ) );
+		m_PipelineCache = vk::PipelineCache();
+	}
+	else if ( cacheFile.GetSize() > 0 )
+	{
+		Log( m_DeviceParams.infoLogSeverity, "Loaded pipeline cache %s (%zu bytes)", m_PipelineCacheFile.c_str(), cacheFile.GetSize() );
+	}
+}
+
+bool DeviceManager_VK::SavePipelineCache()
+{
+	if ( !m_PipelineCache || m_PipelineCacheFile.empty() )
+		return false;
+
+	// the cache can grow between the two calls if pipelines are being created on other threads
+	std::vector<uint8_t> data;
+	vk::Result res = vk::Result::eIncomplete;
+	while ( res == vk::Result::eIncomplete )
+	{
+		size_t size = 0;
+		res = m_VulkanDevice.getPipelineCacheData( m_PipelineCache, &size, nullptr );
+		if ( res != vk::Result::eSuccess )
+			break;
+
+		data.resize( size );
+		res = m_VulkanDevice.getPipelineCacheData( m_PipelineCache, &size, data.data() );
+		data.resize( size );
+	}
+
+	if ( res != vk::Result::eSuccess )
+	{
+		Log( nvrhi::MessageSeverity::Error, "Failed to read the pipeline cache, error code = %s", nvrhi::vulkan::resultToString( res ) );
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories( m_DeviceParams.pipelineCachePath, error );
+
+	if ( !WriteFileAtomically( m_PipelineCacheFile, data.data(), data.size() ) )
+	{
+		Log( nvrhi::MessageSeverity::Error, "Failed to write the pipeline cache to %s", m_PipelineCacheFile.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceManager_VK::createWindowSurface()
+{
+	vk::Result res = vk::Result::eErrorUnknown;
+
+#if VK_USE_PLATFORM_WIN32_KHR
+	const auto& window = m_DeviceParams.windowSurfaceData;
+	const auto surfaceCreateInfo = vk::Win32SurfaceCreateInfoKHR{ {}, window.hInstance, window.hWindow };
+
+	res = m_VulkanInstance.createWin32SurfaceKHR( &surfaceCreateInfo, m_AllocationCallbacks, &m_WindowSurface );
+#elif VK_USE_PLATFORM_XLIB_KHR
+	const auto& window = m_DeviceParams.windowSurfaceData;
+	const auto surfaceCreateInfo = vk::XlibSurfaceCreateInfoKHR{ {}, window.display, window.window };
+
+	res = m_VulkanInstance.createXlibSurfaceKHR( &surfaceCreateInfo, m_AllocationCallbacks, &m_WindowSurface );
+#elif VK_USE_PLATFORM_WAYLAND_KHR
+#error "Wayland is not yet supported"
+#endif
+
+	if ( res != vk::Result::eSuccess )
+	{
+		Log( nvrhi::MessageSeverity::Error, "Failed to create a window surface, error code = %s", nvrhi::vulkan::resultToString( res ) );
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceManager_VK::getPhysicalDevicePresentationSupport( vk::PhysicalDevice& physicalDevice, int queueFamilyIndex )
+{
+#if VK_USE_PLATFORM_WIN32_KHR
+	return physicalDevice.getWin32PresentationSupportKHR( queueFamilyIndex );
+#elif VK_USE_PLATFORM_XLIB_KHR
+	const auto& window = m_DeviceParams.windowSurfaceData;
+
+	// Screen is hardcoded to 0 here, investigate later on to support multiple monitors maybe???
+	VisualID visualId = XVisualIDFromVisual( DefaultVisual( window.display, 0 ) );
+	return physicalDevice.getXlibPresentationSupportKHR( queueFamilyIndex, window.display, visualId );
+#else
+	return false;
+#endif
+}
+
+// Destroys the current and all retired swap chains, the device must be idle
+void DeviceManager_VK::destroySwapChain()
+{
+	retireSwapChain();
+	releaseRetiredSwapChains( std::numeric_limits<uint64_t>::max() );
+
+	// offscreen images in headless mode
+	m_SwapChainImages.clear();
+}
+
+void DeviceManager_VK::retireSwapChain()
+{
+	if ( !m_SwapChain )
+		return;
+
+	// The last present from this swap chain waits on a render-complete semaphore, so the GPU has to be done with
+	// its last frame. With swap chain maintenance, the present fences tell us when the presentation engine is done too,
+	// without it releaseRetiredSwapChains drains the present queue
+	RetiredSwapChain retired;
+	retired.swapChain = m_SwapChain;
+	retired.images = std::move( m_SwapChainImages );
+	retired.frameValue = m_FrameValue;
+	m_RetiredSwapChains.push_back( std::move( retired ) );
+
+	m_SwapChain = nullptr;
+	m_SwapChainImages.clear();
+	m_SwapChainIndex = uint32_t( -1 );
+}
+
+bool DeviceManager_VK::presentsCompleted( const std::vector<SwapChainImage>& images ) const
+{
+	for ( const auto& sci : images )
+	{
+		if ( sci.presentFencePending && m_VulkanDevice.getFenceStatus( sci.presentFence ) != vk::Result::eSuccess )
+			return false;
+
+		for ( const vk::Fence& fence : sci.abandonedPresentFences )
+		{
+			if ( m_VulkanDevice.getFenceStatus( fence ) != vk::Result::eSuccess )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Pass the max uint64_t value to release everything, the device must be idle then
+void DeviceManager_VK::releaseRetiredSwapChains( uint64_t completedFrameValue )
+{
+	const bool releaseAll = completedFrameValue == std::numeric_limits<uint64_t>::max();
+	bool presentQueueIdle = releaseAll;
+
+	auto it = m_RetiredSwapChains.begin();
+	while ( it != m_RetiredSwapChains.end() )
+	{
+		if ( !releaseAll && (it->frameValue > completedFrameValue || !presentsCompleted( it->images )) )
+		{
+			++it;
+			continue;
+		}
+
+		// Nothing else says when the presentation engine is done with the swap chain and the semaphores its presents
+		// waited on. Slow, but it only happens on the frame after a resize
+		if ( !m_SwapChainMaintenance1Supported && !presentQueueIdle )
+		{
+			m_PresentQueue.waitIdle();
+			presentQueueIdle = true;
+		}
+
+		for ( auto& sci : it->images )
+		{
+			m_VulkanDevice.destroySemaphore( sci.renderCompleteSemaphore, m_AllocationCallbacks );
+			if ( sci.presentFence )
+			{
+				m_VulkanDevice.destroyFence( sci.presentFence, m_AllocationCallbacks );
+			}
+			for ( const vk::Fence& fence : sci.abandonedPresentFences )
+			{
+				m_VulkanDevice.destroyFence( fence, m_AllocationCallbacks );
+			}
+		}
+
+		// nvrhi texture handles go away with the images, the swap chain owns the VkImages themselves
+		it->images.clear();
+		m_VulkanDevice.destroySwapchainKHR( it->swapChain, m_AllocationCallbacks );
+
+		it = m_RetiredSwapChains.erase( it );
+	}
+}
+
+static vk::PresentModeKHR ConvertPresentMode( PresentModes::Type presentMode )
+{
+	switch ( presentMode )
+	{
+	case PresentModes::Immediate: return vk::PresentModeKHR::eImmediate;
+	case PresentModes::Mailbox: return vk::PresentModeKHR::eMailbox;
+	case PresentModes::Fifo: return vk::PresentModeKHR::eFifo;
+	case PresentModes::FifoRelaxed: return vk::PresentModeKHR::eFifoRelaxed;
+	}
+
+	return vk::PresentModeKHR::eFifo;
+}
+
+PresentModes::Type DeviceManager_VK::choosePresentMode( bool vsyncEnabled ) const
+{
+	std::vector<PresentModes::Type> candidates = m_DeviceParams.presentModePreference;
+	if ( candidates.empty() )
+	{
+		if ( vsyncEnabled )
+			candidates = { PresentModes::Fifo };
+		else
+			candidates = { PresentModes::Immediate, PresentModes::Mailbox };
+	}
+
+	for ( const PresentModes::Type candidate : candidates )
+	{
+		if ( vsyncEnabled && candidate != PresentModes::Fifo && candidate != PresentModes::FifoRelaxed )
+			continue;
+
+		const vk::PresentModeKHR vkMode = ConvertPresentMode( candidate );
+		if ( std::find( m_SurfacePresentModes.begin(), m_SurfacePresentModes.end(), vkMode ) != m_SurfacePresentModes.end() )
+			return candidate;
+	}
+
+	// FIFO is the only mode every surface has to support
+	return PresentModes::Fifo;
+}
+
+bool DeviceManager_VK::createOffscreenImages()
+{
+	// In-flight frames keep their own references to the old images through nvrhi
+	m_SwapChainImages.clear();
+
+	for ( uint32_t index = 0; index < m_DeviceParams.swapChainBufferCount; index++ )
+	{
+		nvrhi::TextureDesc textureDesc;
+		textureDesc.width = m_DeviceParams.backBufferWidth;
+		textureDesc.height = m_DeviceParams.backBufferHeight;
+		textureDesc.format = m_DeviceParams.swapChainFormat;
+		textureDesc.debugName = "Offscreen back buffer";
+		// there's nobody to present to, so leave the images ready to be read back
+		textureDesc.initialState = nvrhi::ResourceStates::CopySource;
+		textureDesc.keepInitialState = true;
+		textureDesc.isRenderTarget = true;
+
+		SwapChainImage sci;
+		sci.rhiHandle = m_NvrhiDevice->createTexture( textureDesc );
+		if ( !sci.rhiHandle )
+		{
+			Error( "Failed to create an offscreen back buffer" );
+			return false;
+		}
+
+		sci.image = vk::Image( VkImage( sci.rhiHandle->getNativeObject( nvrhi::ObjectTypes::VK_Image ).pointer ) );
+		m_SwapChainImages.push_back( sci );
+	}
+
+	m_SwapChainIndex = 0;
+
+	return true;
+}
+
+bool DeviceManager_VK::createSwapChain()
+{
+	ELR_TRACE_SCOPE( "CreateSwapChain" );
+
+	if ( m_DeviceParams.headless )
+	{
+		return createOffscreenImages();
+	}
+
+	// Handing the old swap chain over lets the driver reuse its resources and keep
+	// presenting what's already queued, so nothing has to be drained here
+	const vk::SwapchainKHR oldSwapChain = m_SwapChain;
+	retireSwapChain();
+
+	m_SwapChainFormat = {
+		vk::Format( nvrhi::vulkan::convertFormat( m_DeviceParams.swapChainFormat ) ),
+		vk::ColorSpaceKHR::eSrgbNonlinear
+	};
+
+	vk::Extent2D extent = vk::Extent2D( m_DeviceParams.backBufferWidth, m_DeviceParams.backBufferHeight );
+
+	std::unordered_set<uint32_t> uniqueQueues = {
+		uint32_t( m_GraphicsQueueFamily ),
+		uint32_t( m_PresentQueueFamily ) };
+
+	std::vector<uint32_t> queues = setToVector( uniqueQueues );
+
+	const bool enableSwapChainSharing = queues.size() > 1;
+
+	const PresentModes::Type presentMode = choosePresentMode( m_DeviceParams.vsyncEnabled );
+
+	m_SwapChainPresentModes = { ConvertPresentMode( presentMode ) };
+#ifdef VK_EXT_swapchain_maintenance1
+	if ( m_SwapChainMaintenance1Supported )
+	{
+		// ask which other modes we can switch to later without recreating the swap chain
+		auto surfacePresentMode = vk::SurfacePresentModeEXT()
+			.setPresentMode( ConvertPresentMode( presentMode ) );
+		auto surfaceInfo = vk::PhysicalDeviceSurfaceInfo2KHR()
+			.setSurface( m_WindowSurface )
+			.setPNext( &surfacePresentMode );
+
+		// there are only a handful of present modes in existence
+		std::array<vk::PresentModeKHR, 8> compatibleModes{};
+		auto compatibility = vk::SurfacePresentModeCompatibilityEXT()
+			.setPresentModeCount( uint32_t( compatibleModes.size() ) )
+			.setPPresentModes( compatibleModes.data() );
+		auto surfaceCaps = vk::SurfaceCapabilities2KHR()
+			.setPNext( &compatibility );
+
+		if ( m_VulkanPhysicalDevice.getSurfaceCapabilities2KHR( &surfaceInfo, &surfaceCaps ) == vk::Result::eSuccess )
+		{
+			for ( uint32_t i = 0; i < compatibility.presentModeCount; i++ )
+			{
+				if ( compatibleModes[i] != m_SwapChainPresentModes[0] )
+					m_SwapChainPresentModes.push_back( compatibleModes[i] );
+			}
+		}
+	}
+
+	auto presentModesInfo = vk::SwapchainPresentModesCreateInfoEXT()
+		.setPresentModeCount( uint32_t( m_SwapChainPresentModes.size() ) )
+		.setPPresentModes( m_SwapChainPresentModes.data() );
+#endif
+
+	auto desc = vk::SwapchainCreateInfoKHR()
+		.setSurface( m_WindowSurface )
+		.setMinImageCount( m_DeviceParams.swapChainBufferCount )
+		.setImageFormat( m_SwapChainFormat.format )
+		.setImageColorSpace( m_SwapChainFormat.colorSpace )
+		.setImageExtent( extent )
+		.setImageArrayLayers( 1 )
+		.setImageUsage( vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled )
+		.setImageSharingMode( enableSwapChainSharing ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive )
+		.setQueueFamilyIndexCount( enableSwapChainSharing ? uint32_t( queues.size() ) : 0 )
+		.setPQueueFamilyIndices( enableSwapChainSharing ? queues.data() : nullptr )
+		.setPreTransform( vk::SurfaceTransformFlagBitsKHR::eIdentity )
+		.setCompositeAlpha( vk::CompositeAlphaFlagBitsKHR::eOpaque )
+		.setPresentMode( ConvertPresentMode( presentMode ) )
+		.setClipped( true )
+		.setOldSwapchain( oldSwapChain );
+
+#ifdef VK_EXT_swapchain_maintenance1
+	if ( m_SwapChainMaintenance1Supported )
+	{
+		desc.setPNext( &presentModesInfo );
+	}
+#endif
+
+	const vk::Result res = m_VulkanDevice.createSwapchainKHR( &desc, m_AllocationCallbacks, &m_SwapChain );
+	if ( res != vk::Result::eSuccess )
+	{
+		Log( nvrhi::MessageSeverity::Error, "Failed to create a Vulkan swap chain, error code = %s", nvrhi::vulkan::resultToString( res ) );
+		return false;
+	}
+
+	// retrieve swap chain images
+	auto images = m_VulkanDevice.getSwapchainImagesKHR( m_SwapChain );
+	for ( auto image : images )
+	{
+		SwapChainImage sci;
+		sci.image = image;
+
+		nvrhi::TextureDesc textureDesc;
+		textureDesc.width = m_DeviceParams.backBufferWidth;
+		textureDesc.height = m_DeviceParams.backBufferHeight;
+		textureDesc.format = m_DeviceParams.swapChainFormat;
+		textureDesc.debugName = "Swap chain image";
+		textureDesc.initialState = nvrhi::ResourceStates::Present;
+		textureDesc.keepInitialState = true;
+		textureDesc.isRenderTarget = true;
+
+		sci.rhiHandle = m_NvrhiDevice->createHandleForNativeTexture( nvrhi::ObjectTypes::VK_Image, nvrhi::Object( sci.image ), textureDesc );
+		sci.renderCompleteSemaphore = m_VulkanDevice.createSemaphore( vk::SemaphoreCreateInfo(), m_AllocationCallbacks );
+		if ( m_SwapChainMaintenance1Supported )
+		{
+			sci.presentFence = m_VulkanDevice.createFence( vk::FenceCreateInfo(), m_AllocationCallbacks );
+		}
+		m_SwapChainImages.push_back( sci );
+	}
+
+	m_SwapChainIndex = 0;
+	m_PresentMode = presentMode;
+	m_PresentModeVSync = m_DeviceParams.vsyncEnabled;
+	m_SwapChainFirstPresentId = m_FrameValue + 1;
+
+	return true;
+}
+
+bool DeviceManager_VK::CreateDeviceAndSwapChain()
+{
+	return createDeviceObjects( !m_DeviceParams.headless ) && createSwapChain();
+}
+
+bool DeviceManager_VK::CreateDeviceOnly()
+{
+	// the offscreen images of headless mode don't need a window
+	if ( m_DeviceParams.headless )
+		return CreateDeviceAndSwapChain();
+
+	return createDeviceObjects( false );
+}
+
+bool DeviceManager_VK::CreateWindowSurfaceAndSwapChain()
+{
+	if ( m_DeviceParams.headless || m_WindowSurface )
+	{
+		Error( "Only one window surface can be attached, and none in headless mode" );
+		return false;
+	}
+
+	if ( !createWindowSurface() )
+		return false;
+
+	// The device was picked without this surface in mind, so it has to be able
+	// to present to it from the graphics queue and take our swap chain parameters
+	std::stringstream errorStream;
+	errorStream << "Cannot attach the window surface to " << m_RendererString << ":";
+
+	bool surfaceIsGood = checkSurfaceSupport( m_VulkanPhysicalDevice, errorStream );
+	if ( !m_VulkanPhysicalDevice.getSurfaceSupportKHR( m_GraphicsQueueFamily, m_WindowSurface ) )
+	{
+		errorStream << std::endl << "  - cannot present from the graphics queue";
+		surfaceIsGood = false;
+	}
+
+	if ( !surfaceIsGood )
+	{
+		Error( errorStream.str().c_str() );
+
+		m_VulkanInstance.destroySurfaceKHR( m_WindowSurface, m_AllocationCallbacks );
+		m_WindowSurface = nullptr;
+		return false;
+	}
+
+	m_SurfacePresentModes = m_VulkanPhysicalDevice.getSurfacePresentModesKHR( m_WindowSurface );
+
+	return createSwapChain();
+}
+
+bool DeviceManager_VK::createDeviceObjects( bool withSurface )
+{
+	ELR_TRACE_SCOPE( "CreateDevice" );
+
+	// Kept around after Shutdown, so the report can still show what leaked. A device created
+	// later reuses it, the pools would have to be warmed up again otherwise
+	if ( m_DeviceParams.vulkanHostAllocationCallbacks && !m_HostAllocator )
+	{
+		m_HostAllocator = std::make_unique<VulkanHostAllocator>();
+	}
+	m_AllocationCallbacks = m_DeviceParams.vulkanHostAllocationCallbacks
+		? reinterpret_cast<const vk::AllocationCallbacks*>( m_HostAllocator->GetCallbacks() )
+		: nullptr;
+
+	if ( m_DeviceParams.enableDebugRuntime )
+	{
+		enabledExtensions.instance.insert( VulkanInstanceExtensions::DebugUtils );
+		enabledExtensions.layers.insert( "VK_LAYER_KHRONOS_validation" );
+	}
+
+	if ( m_DeviceParams.headless )
+	{
+		// no surface and no swap chain, so none of the presentation extensions either
+		enabledExtensions.device.erase( VK_KHR_SWAPCHAIN_EXTENSION_NAME );
+#ifdef VK_EXT_swapchain_maintenance1
+		optionalExtensions.instance.erase( VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME );
+		optionalExtensions.instance.erase( VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME );
+		optionalExtensions.device.erase( VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME );
+#endif
+	}
+	else
+	{
+		// The instance has to be able to create the surface, whether it comes now or later
+		enabledExtensions.instance.insert( VK_KHR_SURFACE_EXTENSION_NAME );
+#if VK_USE_PLATFORM_WIN32_KHR
+		enabledExtensions.instance.insert( VK_KHR_WIN32_SURFACE_EXTENSION_NAME );
+#elif VK_USE_PLATFORM_XLIB_KHR
+		enabledExtensions.instance.insert( VK_KHR_XLIB_SURFACE_EXTENSION_NAME );
+#elif VK_USE_PLATFORM_WAYLAND_KHR
+		enabledExtensions.instance.insert( VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME );
+#endif
+	}
+
+	const vk::DynamicLoader dl;
+	const PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr =   // NOLINT(misc-misplaced-const)
+		dl.getProcAddress<PFN_vkGetInstanceProcAddr>( "vkGetInstanceProcAddr" );
+	VULKAN_HPP_DEFAULT_DISPATCHER.init( vkGetInstanceProcAddr );
+
+#define CHECK(a) if (!(a)) { return false; }
+
+	CHECK( createInstance() )
+
+		if ( m_DeviceParams.enableDebugRuntime )
+		{
+			installDebugCallback();
+		}
+
+	// offscreen images can have whatever format was asked for
+	if ( !m_DeviceParams.headless )
+	{
+		if ( m_DeviceParams.swapChainFormat == nvrhi::Format::SRGBA8_UNORM )
+			m_DeviceParams.swapChainFormat = nvrhi::Format::SBGRA8_UNORM;
+		else if ( m_DeviceParams.swapChainFormat == nvrhi::Format::RGBA8_UNORM )
+			m_DeviceParams.swapChainFormat = nvrhi::Format::BGRA8_UNORM;
+	}
+
+	// add device extensions requested by the user
+	for ( const std::string& name : m_DeviceParams.requiredVulkanDeviceExtensions )
+	{
+		enabledExtensions.device.insert( name );
+	}
+	for ( const std::string& name : m_DeviceParams.optionalVulkanDeviceExtensions )
+	{
+		optionalExtensions.device.insert( name );
+	}
+
+	if ( m_DeviceParams.enableDynamicRendering )
+	{
+		// only needed on 1.2 devices, it's core in 1.3
+		optionalExtensions.device.insert( VulkanDeviceExtensions::DynamicRendering );
+	}
+
+	if ( m_DeviceParams.enablePresentWait && !m_DeviceParams.headless )
+	{
+		optionalExtensions.device.insert( VK_KHR_PRESENT_ID_EXTENSION_NAME );
+		optionalExtensions.device.insert( VK_KHR_PRESENT_WAIT_EXTENSION_NAME );
+	}
+
+	if ( withSurface )
+	{
+		CHECK( createWindowSurface() )
+	}
+
+	CHECK( pickPhysicalDevice() )
+		CHECK( findQueueFamilies( m_VulkanPhysicalDevice ) )
+		CHECK( createDevice() )
+
+	createPipelineCache();
+
+		auto vecInstanceExt = enabledExtensions.instance.names();
+	auto vecLayers = stringSetToVector( enabledExtensions.layers );
+	auto vecDeviceExt = enabledExtensions.device.names();
+
+	nvrhi::vulkan::DeviceDesc deviceDesc;
+	deviceDesc.errorCB = GetNvrhiMessageCallback();
+	deviceDesc.instance = m_VulkanInstance;
+	deviceDesc.physicalDevice = m_VulkanPhysicalDevice;
+	deviceDesc.device = m_VulkanDevice;
+	deviceDesc.graphicsQueue = m_GraphicsQueue;
+	deviceDesc.graphicsQueueIndex = m_GraphicsQueueFamily;
+	if ( m_DeviceParams.enableComputeQueue )
+	{
+		deviceDesc.computeQueue = m_ComputeQueue;
+		deviceDesc.computeQueueIndex = m_ComputeQueueFamily;
+	}
+	if ( m_DeviceParams.enableCopyQueue )
+	{
+		deviceDesc.transferQueue = m_TransferQueue;
+		deviceDesc.transferQueueIndex = m_TransferQueueFamily;
+	}
+	deviceDesc.instanceExtensions = vecInstanceExt.data();
+	deviceDesc.numInstanceExtensions = vecInstanceExt.size();
+	deviceDesc.deviceExtensions = vecDeviceExt.data();
+	deviceDesc.numDeviceExtensions = vecDeviceExt.size();
+	deviceDesc.allocationCallbacks = const_cast<VkAllocationCallbacks*>( reinterpret_cast<const VkAllocationCallbacks*>( m_AllocationCallbacks ) );
+
+	m_NvrhiDevice = nvrhi::vulkan::createDevice( deviceDesc );
+
+	if ( m_DeviceParams.enableNvrhiValidationLayer )
+	{
+		m_ValidationLayer = nvrhi::validation::createValidationLayer( m_NvrhiDevice );
+	}
+
+	m_BarrierCommandList = m_NvrhiDevice->createCommandList();
+
+	m_AcquireSemaphores.resize( m_DeviceParams.maxFramesInFlight + 1 );
+	for ( auto& semaphore : m_AcquireSemaphores )
+	{
+		semaphore = m_VulkanDevice.createSemaphore( vk::SemaphoreCreateInfo(), m_AllocationCallbacks );
+	}
+	m_AcquireSemaphoreIndex = 0;
+
+	auto frameSemaphoreType = vk::SemaphoreTypeCreateInfo()
+		.setSemaphoreType( vk::SemaphoreType::eTimeline )
+		.setInitialValue( 0 );
+
+	m_FrameSemaphore = m_VulkanDevice.createSemaphore( vk::SemaphoreCreateInfo().setPNext( &frameSemaphoreType ), m_AllocationCallbacks );
+	m_FrameValue = 0;
+
+#undef CHECK
+
+	return true;
+}
+
+void DeviceManager_VK::DestroyDeviceAndSwapChain()
+{
+	ELR_TRACE_SCOPE( "DestroyDevice" );
+
+	if ( m_VulkanDevice )
+	{
+		m_VulkanDevice.waitIdle();
+	}
+
+	destroySwapChain();
+
+	for ( auto& semaphore : m_AcquireSemaphores )
+	{
+		m_VulkanDevice.destroySemaphore( semaphore, m_AllocationCallbacks );
+	}
+	m_AcquireSemaphores.clear();
+
+	m_VulkanDevice.destroySemaphore( m_FrameSemaphore, m_AllocationCallbacks );
+	m_FrameSemaphore = vk::Semaphore();
+	m_FrameValue = 0;
+
+	m_BarrierCommandList = nullptr;
+
+	m_NvrhiDevice = nullptr;
+	m_ValidationLayer = nullptr;
+	m_RendererString.clear();
+
+	if ( m_DebugMessenger )
+	{
+		flushValidationMessages();
+		m_VulkanInstance.destroyDebugUtilsMessengerEXT( m_DebugMessenger, m_AllocationCallbacks );
+		m_DebugMessenger = vk::DebugUtilsMessengerEXT();
+	}
+	m_ValidationCounters.clear();
+
+	if ( m_PipelineCache )
+	{
+		SavePipelineCache();
+		m_VulkanDevice.destroyPipelineCache( m_PipelineCache, m_AllocationCallbacks );
+		m_PipelineCache = vk::PipelineCache();
+	}
+	m_PipelineCacheFile.clear();
+
+	if ( m_VulkanDevice )
+	{
+		m_VulkanDevice.destroy( m_AllocationCallbacks );
+		m_VulkanDevice = nullptr;
+	}
+	m_DeviceCapabilities = DeviceCapabilities();
+
+	if ( m_WindowSurface )
+	{
+		assert( m_VulkanInstance );
+		m_VulkanInstance.destroySurfaceKHR( m_WindowSurface, m_AllocationCallbacks );
+		m_WindowSurface = nullptr;
+	}
+
+	if ( m_VulkanInstance )
+	{
+		m_VulkanInstance.destroy( m_AllocationCallbacks );
+		m_VulkanInstance = nullptr;
+	}
+	m_AllocationCallbacks = nullptr;
+}
+
+void DeviceManager_VK::ReportLiveObjects()
+{
+	if ( !m_HostAllocator )
+		return;
+
+	// After Shutdown, anything still live is a leak in the driver, the loader or a layer
+	bool leaked = false;
+	for ( uint32_t scope = 0; scope < VulkanHostAllocator::NumScopes; scope++ )
+	{
+		leaked |= m_HostAllocator->GetStats( VkSystemAllocationScope( scope ) ).liveAllocations > 0;
+	}
+
+	const nvrhi::MessageSeverity severity = (leaked && !m_VulkanInstance) ? nvrhi::MessageSeverity::Warning : m_DeviceParams.infoLogSeverity;
+	Message( m_HostAllocator->GetReport().c_str(), severity );
+}
+
+void DeviceManager_VK::BeginFrame()
+{
+	ELR_TRACE_SCOPE( "BeginFrame" );
+
+	waitForQueuedPresents();
+
+	if ( !m_RetiredSwapChains.empty() )
+	{
+		releaseRetiredSwapChains( GetCompletedFrameValue() );
+	}
+
+	if ( m_DeviceParams.headless )
+	{
+		// no presentation engine to ask, just cycle through the offscreen images
+		m_SwapChainIndex = uint32_t( m_FrameValue % m_SwapChainImages.size() );
+		return;
+	}
+
+	// Present already waited for the frame that last used this slot, see GetFramesInFlight
+	const vk::Semaphore& acquireSemaphore = m_AcquireSemaphores[m_AcquireSemaphoreIndex];
+	m_AcquireSemaphoreIndex = (m_AcquireSemaphoreIndex + 1) % uint32_t( m_AcquireSemaphores.size() );
+
+	{
+		ELR_TRACE_SCOPE( "AcquireNextImage" );
+		const BlockingTimer timer( *this, BlockingCalls::AcquireImage );
+
+		const vk::Result res = m_VulkanDevice.acquireNextImageKHR( m_SwapChain,
+			std::numeric_limits<uint64_t>::max(), // timeout
+			acquireSemaphore,
+			vk::Fence(),
+			&m_SwapChainIndex );
+
+		assert( res == vk::Result::eSuccess );
+	}
+
+	ELR_TRACE_SCOPE( "QueueWaitForSemaphore" );
+	m_NvrhiDevice->queueWaitForSemaphore( nvrhi::CommandQueue::Graphics, acquireSemaphore, 0 );
+}
+
+void DeviceManager_VK::waitForFrameValue( uint64_t frameValue )
+{
+	if ( frameValue == 0 )
+		return;
+
+	ELR_TRACE_SCOPE( "WaitForFrame" );
+	const BlockingTimer timer( *this, BlockingCalls::FrameWait );
+
+	auto waitInfo = vk::SemaphoreWaitInfo()
+		.setSemaphoreCount( 1 )
+		.setPSemaphores( &m_FrameSemaphore )
+		.setPValues( &frameValue );
+
+	const vk::Result res = m_VulkanDevice.waitSemaphores( &waitInfo, std::numeric_limits<uint64_t>::max() );
+	assert( res == vk::Result::eSuccess );
+}
+
+void DeviceManager_VK::waitForQueuedPresents()
+{
+	const uint32_t maxQueuedFrames = m_DeviceParams.maxQueuedFrames;
+	if ( !m_PresentWaitSupported || maxQueuedFrames == 0 )
+		return;
+
+	// The frame we're about to begin gets presented with the next frame value
+	const uint64_t nextPresentId = m_FrameValue + 1;
+	if ( nextPresentId <= maxQueuedFrames )
+		return;
+
+	const uint64_t waitPresentId = nextPresentId - maxQueuedFrames;
+	if ( waitPresentId < m_SwapChainFirstPresentId )
+		return;
+
+	// Don't hang forever if the compositor never shows the frame, e.g. when the window is hidden.
+	// Timeouts and out-of-date swap chains just mean we stop limiting for this frame
+	constexpr uint64_t PresentWaitTimeout = 100'000'000; // 100ms in nanoseconds
+	ELR_TRACE_SCOPE( "WaitForPresent" );
+	const BlockingTimer timer( *this, BlockingCalls::PresentWait );
+	VULKAN_HPP_DEFAULT_DISPATCHER.vkWaitForPresentKHR( static_cast<VkDevice>( m_VulkanDevice ),
+		static_cast<VkSwapchainKHR>( m_SwapChain ), waitPresentId, PresentWaitTimeout );
+}
+
+void DeviceManager_VK::presentSwapChainImage()
+{
+	// covers the wait for the image's previous present as well as the present itself
+	const BlockingTimer timer( *this, BlockingCalls::Present );
+
+	vk::PresentInfoKHR info = vk::PresentInfoKHR()
+		.setWaitSemaphoreCount( 1 )
+		.setPWaitSemaphores( &m_SwapChainImages[m_SwapChainIndex].renderCompleteSemaphore )
+		.setSwapchainCount( 1 )
+		.setPSwapchains( &m_SwapChain )
+		.setPImageIndices( &m_SwapChainIndex );
+
+#ifdef VK_EXT_swapchain_maintenance1
+	SwapChainImage& image = m_SwapChainImages[m_SwapChainIndex];
+
+	// UpdateWindowSize only skips the resize when the new mode is compatible with this swap chain
+	if ( m_SwapChainMaintenance1Supported && m_PresentModeVSync != m_DeviceParams.vsyncEnabled )
+	{
+		m_PresentMode = choosePresentMode( m_DeviceParams.vsyncEnabled );
+		m_PresentModeVSync = m_DeviceParams.vsyncEnabled;
+	}
+
+	const vk::PresentModeKHR presentMode = ConvertPresentMode( m_PresentMode );
+	auto presentModeInfo = vk::SwapchainPresentModeInfoEXT()
+		.setSwapchainCount( 1 )
+		.setPPresentModes( &presentMode );
+	auto presentFenceInfo = vk::SwapchainPresentFenceInfoEXT()
+		.setSwapchainCount( 1 )
+		.setPFences( &image.presentFence )
+		.setPNext( &presentModeInfo );
+
+	if ( m_SwapChainMaintenance1Supported )
+	{
+		// The image was just acquired again, so its previous present is practically always done by now.
+		// Don't hang if the presentation engine never lets go of it though, e.g. with a lost surface
+		constexpr uint64_t PresentFenceTimeout = 100'000'000; // 100ms in nanoseconds
+		if ( image.presentFencePending )
+		{
+			vk::Result fenceRes = m_VulkanDevice.waitForFences( 1, &image.presentFence, true, PresentFenceTimeout );
+			if ( fenceRes == vk::Result::eSuccess )
+			{
+				fenceRes = m_VulkanDevice.resetFences( 1, &image.presentFence );
+				assert( fenceRes == vk::Result::eSuccess );
+			}
+			else
+			{
+				Log( nvrhi::MessageSeverity::Error, "The previous present of swap chain image %u didn't finish in time, error code = %s",
+					m_SwapChainIndex, nvrhi::vulkan::resultToString( fenceRes ) );
+
+				// the presents of this swap chain can't be tracked anymore without a fresh fence
+				image.abandonedPresentFences.push_back( image.presentFence );
+				image.presentFence = m_VulkanDevice.createFence( vk::FenceCreateInfo(), m_AllocationCallbacks );
+			}
+		}
+
+		image.presentFencePending = true;
+		info.setPNext( &presentFenceInfo );
+	}
+#endif
+
+	const uint64_t presentId = m_FrameValue;
+	auto presentIdInfo = vk::PresentIdKHR()
+		.setSwapchainCount( 1 )
+		.setPPresentIds( &presentId );
+
+	if ( m_PresentWaitSupported )
+	{
+		presentIdInfo.setPNext( info.pNext );
+		info.setPNext( &presentIdInfo );
+	}
+
+	ELR_TRACE_SCOPE( "PresentKHR" );
+	const vk::Result res = m_PresentQueue.presentKHR( &info );
+	assert( res == vk::Result::eSuccess || res == vk::Result::eErrorOutOfDateKHR );
+}
+
+void DeviceManager_VK::Present()
+{
+	ELR_TRACE_SCOPE( "Present" );
+
+	if ( !m_DeviceParams.headless )
+	{
+		// The render-complete semaphore belongs to the image, it can't be signalled again
+		// before the image is re-acquired, which implies its previous present went through
+		const vk::Semaphore& renderCompleteSemaphore = m_SwapChainImages[m_SwapChainIndex].renderCompleteSemaphore;
+		m_NvrhiDevice->queueSignalSemaphore( nvrhi::CommandQueue::Graphics, renderCompleteSemaphore, 0 );
+	}
+
+	// The barrier command list is the last submission of the frame, so the frame
+	// semaphore reaching this value means the whole frame is done on the GPU
+	m_FrameValue++;
+	m_NvrhiDevice->queueSignalSemaphore( nvrhi::CommandQueue::Graphics, m_FrameSemaphore, m_FrameValue );
+
+	{
+		ELR_TRACE_SCOPE( "SubmitBarrierCommandList" );
+
+		m_BarrierCommandList->open(); // umm...
+		m_BarrierCommandList->close();
+		m_NvrhiDevice->executeCommandList( m_BarrierCommandList );
+	}
+
+	if ( !m_DeviceParams.headless )
+	{
+		presentSwapChainImage();
+	}
+
+	flushValidationMessages();
+
+	// The validation layers are happy as long as no semaphore or image is reused before the GPU
+	// is done with it, the acquire/render-complete semaphores and frame pacing take care of that
+	if ( m_DeviceParams.vulkanWaitIdleAfterPresent )
+	{
+		m_PresentQueue.waitIdle();
+	}
+
+	// Keep at most GetFramesInFlight() frames queued up on the GPU
+	const uint64_t waitFrameValue = PrepareFrameWait();
+	if ( waitFrameValue > 0 )
+	{
+		waitForFrameValue( waitFrameValue );
+	}
+
+	UpdateFrameTime();
+}
+
+bool DeviceManager_VK::VSyncChangeRequiresResize( bool vsyncEnabled ) const
+{
+	if ( m_DeviceParams.headless )
+		return false;
+
+	if ( !m_SwapChainMaintenance1Supported )
+		return true;
+
+	const vk::PresentModeKHR presentMode = ConvertPresentMode( choosePresentMode( vsyncEnabled ) );
+	return std::find( m_SwapChainPresentModes.begin(), m_SwapChainPresentModes.end(), presentMode ) == m_SwapChainPresentModes.end();
+}
+
+DeviceManager* DeviceManager::CreateVK()
+{
+	return new DeviceManager_VK();
+}
@@ -0,0 +1,181 @@
+#include "FileUtils.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace nvrhi::app;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open( const std::string& path )
+{
+	Close();
+
+	HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize{};
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( nullptr == mapping )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	void* data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( nullptr == data )
+	{
+		CloseHandle( mapping );
+		CloseHandle( file );
+		return false;
+	}
+
+	m_File = file;
+	m_Mapping = mapping;
+	m_Data = data;
+	m_Size = size_t( fileSize.QuadPart );
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if ( m_Data )
+		UnmapViewOfFile( m_Data );
+	if ( m_Mapping )
+		CloseHandle( m_Mapping );
+	if ( m_File )
+		CloseHandle( m_File );
+
+	m_Data = nullptr;
+	m_Mapping = nullptr;
+	m_File = nullptr;
+	m_Size = 0;
+}
+
+bool nvrhi::app::WriteFileAtomically( const std::string& path, const void* data, size_t size )
+{
+	// unique per process, in case several instances shut down at once
+	const std::string tempPath = path + "." + std::to_string( GetCurrentProcessId() ) + ".tmp";
+
+	HANDLE file = CreateFileA( tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	const char* bytes = static_cast<const char*>( data );
+	size_t written = 0;
+	while ( written < size )
+	{
+		DWORD chunk = 0;
+		const DWORD toWrite = DWORD( std::min<size_t>( size - written, 0x40000000 ) );
+		if ( !WriteFile( file, bytes + written, toWrite, &chunk, nullptr ) )
+			break;
+
+		written += chunk;
+	}
+
+	const bool ok = written == size && FlushFileBuffers( file );
+	CloseHandle( file );
+
+	if ( !ok || !MoveFileExA( tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) )
+	{
+		DeleteFileA( tempPath.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+#else
+
+bool MappedFile::Open( const std::string& path )
+{
+	Close();
+
+	const int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+		return false;
+
+	struct stat fileStat{};
+	if ( fstat( fd, &fileStat ) != 0 || fileStat.st_size <= 0 )
+	{
+		close( fd );
+		return false;
+	}
+
+	void* data = mmap( nullptr, size_t( fileStat.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+	// the mapping stays valid after the descriptor is closed
+	close( fd );
+
+	if ( data == MAP_FAILED )
+		return false;
+
+	m_Data = data;
+	m_Size = size_t( fileStat.st_size );
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if ( m_Data )
+		munmap( m_Data, m_Size );
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+bool nvrhi::app::WriteFileAtomically( const std::string& path, const void* data, size_t size )
+{
+	// unique per process, in case several instances shut down at once
+	const std::string tempPath = path + "." + std::to_string( getpid() ) + ".tmp";
+
+	const int fd = open( tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+	if ( fd < 0 )
+		return false;
+
+	const char* bytes = static_cast<const char*>( data );
+	size_t written = 0;
+	while ( written < size )
+	{
+		const ssize_t chunk = write( fd, bytes + written, size - written );
+		if ( chunk < 0 )
+			break;
+
+		written += size_t( chunk );
+	}
+
+	const bool ok = written == size && fsync( fd ) == 0;
+	close( fd );
+
+	if ( !ok || rename( tempPath.c_str(), path.c_str() ) != 0 )
+	{
+		unlink( tempPath.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,39 @@
+// Small file helpers for the backends, not part of the public API
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace nvrhi::app
+{
+	// Read-only view of a whole file, mapped into memory so it can be handed to the driver without a copy
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile( const MappedFile& ) = delete;
+		MappedFile& operator=( const MappedFile& ) = delete;
+
+		// Returns false if the file doesn't exist, can't be mapped or is empty
+		bool Open( const std::string& path );
+		void Close();
+
+		[[nodiscard]] const void* GetData() const { return m_Data; }
+		[[nodiscard]] size_t GetSize() const { return m_Size; }
+
+	private:
+		void* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef _WIN32
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#endif
+	};
+
+	// Writes to a temporary file next to path, then renames it over path, so readers (and crashes)
+	// only ever see either the old or the new contents
+	bool WriteFileAtomically( const std::string& path, const void* data, size_t size );
+}
@@ -0,0 +1,112 @@
+#include "elegy-rhi/FrameTimeStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace nvrhi::app;
+
+// How quickly the moving average used for live stutter detection follows the frame time
+static constexpr double MovingAverageWeight = 0.05;
+
+FrameTimeStatistics::FrameTimeStatistics()
+{
+	clearSamples();
+}
+
+void FrameTimeStatistics::AddSample( double seconds )
+{
+	if ( m_ResetRequested.exchange( false, std::memory_order_acquire ) )
+	{
+		clearSamples();
+	}
+
+	const uint64_t index = m_NumSamples.load( std::memory_order_relaxed );
+
+	if ( index > 0 && seconds > m_MovingAverage * GetStutterThreshold() )
+	{
+		m_TotalStutterCount.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	m_MovingAverage = (index == 0) ? seconds : m_MovingAverage + (seconds - m_MovingAverage) * MovingAverageWeight;
+
+	m_Samples[index % MaxSamples].store( float( seconds ), std::memory_order_relaxed );
+	m_NumSamples.store( index + 1, std::memory_order_release );
+}
+
+void FrameTimeStatistics::Reset()
+{
+	m_ResetRequested.store( true, std::memory_order_release );
+}
+
+void FrameTimeStatistics::clearSamples()
+{
+	for ( auto& sample : m_Samples )
+	{
+		sample.store( 0.0f, std::memory_order_relaxed );
+	}
+
+	m_TotalStutterCount.store( 0, std::memory_order_relaxed );
+	m_MovingAverage = 0.0;
+	m_NumSamples.store( 0, std::memory_order_release );
+}
+
+// Nearest-rank percentile, reorders the samples
+static double Percentile( float* samples, uint32_t count, double percentile )
+{
+	uint32_t rank = uint32_t( std::ceil( percentile * count ) );
+	rank = std::clamp( rank, 1u, count );
+
+	std::nth_element( samples, samples + rank - 1, samples + count );
+	return samples[rank - 1];
+}
+
+bool FrameTimeStatistics::GetSummary( FrameTimeSummary& outSummary ) const
+{
+	if ( m_ResetRequested.load( std::memory_order_acquire ) )
+	{
+		outSummary = FrameTimeSummary();
+		return false;
+	}
+
+	const uint64_t totalFrames = m_NumSamples.load( std::memory_order_acquire );
+	outSummary = FrameTimeSummary();
+	outSummary.totalFrames = totalFrames;
+	outSummary.totalStutterCount = m_TotalStutterCount.load( std::memory_order_relaxed );
+
+	if ( totalFrames == 0 )
+		return false;
+
+	const uint32_t count = uint32_t( std::min<uint64_t>( totalFrames, MaxSamples ) );
+
+	// copy the window so the percentiles can be found in place, without allocating
+	std::array<float, MaxSamples> samples;
+	double sum = 0.0;
+	float minTime = std::numeric_limits<float>::max();
+	float maxTime = 0.0f;
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		const float sample = m_Samples[(totalFrames - count + i) % MaxSamples].load( std::memory_order_relaxed );
+		samples[i] = sample;
+		sum += sample;
+		minTime = std::min( minTime, sample );
+		maxTime = std::max( maxTime, sample );
+	}
+
+	outSummary.numFrames = count;
+	outSummary.mean = sum / count;
+	outSummary.min = minTime;
+	outSummary.max = maxTime;
+	outSummary.p50 = Percentile( samples.data(), count, 0.50 );
+	outSummary.p95 = Percentile( samples.data(), count, 0.95 );
+	outSummary.p99 = Percentile( samples.data(), count, 0.99 );
+
+	const double stutterTime = outSummary.p50 * GetStutterThreshold();
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		if ( samples[i] > stutterTime )
+			outSummary.stutterCount++;
+	}
+
+	return true;
+}
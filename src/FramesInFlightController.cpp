@@ -0,0 +1,90 @@
+#include "elegy-rhi/FramesInFlightController.hpp"
+
+#include <algorithm>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	// Waits shorter than this part of the frame are scheduling noise, not the GPU holding the CPU back
+	constexpr double GpuBoundWaitFraction = 0.05;
+	// Frames of each kind it takes in one window before a deeper queue is considered worth it
+	constexpr uint32_t MinMixedFrames = 3;
+	// A GPU-bound window only gets a shallower queue if no frame took longer than this times the average,
+	// bigger spikes are what the extra frame in flight is absorbing
+	constexpr double SteadyFrameTimeRatio = 1.5;
+	constexpr uint32_t MaxBackoffWindows = 32;
+}
+
+void FramesInFlightController::Reset( uint32_t minFrames, uint32_t maxFrames )
+{
+	m_MaxFrames = std::max( maxFrames, 1u );
+	m_MinFrames = std::clamp( minFrames, 1u, m_MaxFrames );
+	m_FramesInFlight = m_MaxFrames;
+	m_HoldWindows = 0;
+	m_Backoff = 1;
+
+	beginWindow();
+}
+
+void FramesInFlightController::AddFrame( double frameTime, double frameWaitTime, uint64_t framesQueued )
+{
+	m_WindowFrameCount++;
+	m_FrameTimeSum += frameTime;
+	m_MaxFrameTime = std::max( m_MaxFrameTime, frameTime );
+
+	if ( frameWaitTime > frameTime * GpuBoundWaitFraction )
+	{
+		m_GpuBoundFrames++;
+	}
+
+	if ( framesQueued <= 1 )
+	{
+		m_StarvedFrames++;
+	}
+
+	if ( m_WindowFrameCount < WindowFrames )
+		return;
+
+	const double averageFrameTime = m_FrameTimeSum / double( m_WindowFrameCount );
+	const bool steady = m_MaxFrameTime <= averageFrameTime * SteadyFrameTimeRatio;
+	const bool mixed = m_GpuBoundFrames >= MinMixedFrames && m_StarvedFrames >= MinMixedFrames;
+
+	if ( mixed )
+	{
+		// throughput is being lost, take the extra frame of latency
+		if ( m_FramesInFlight < m_MaxFrames )
+		{
+			m_FramesInFlight++;
+			m_HoldWindows = m_Backoff;
+			m_Backoff = std::min( m_Backoff * 2, MaxBackoffWindows );
+		}
+	}
+	else if ( m_HoldWindows > 0 )
+	{
+		m_HoldWindows--;
+	}
+	else if ( m_GpuBoundFrames == 0 || (m_StarvedFrames == 0 && steady) )
+	{
+		// the GPU has headroom, or always has work queued and nothing to absorb
+		if ( m_FramesInFlight > m_MinFrames )
+		{
+			m_FramesInFlight--;
+		}
+		else
+		{
+			m_Backoff = std::max( m_Backoff / 2, 1u );
+		}
+	}
+
+	beginWindow();
+}
+
+void FramesInFlightController::beginWindow()
+{
+	m_WindowFrameCount = 0;
+	m_GpuBoundFrames = 0;
+	m_StarvedFrames = 0;
+	m_FrameTimeSum = 0.0;
+	m_MaxFrameTime = 0.0;
+}
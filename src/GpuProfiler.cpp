@@ -0,0 +1,155 @@
+#include "elegy-rhi/GpuProfiler.hpp"
+
+#include <cassert>
+
+using namespace nvrhi::app;
+
+GpuProfiler::GpuProfiler( nvrhi::IDevice* device, uint32_t maxFramesInFlight )
+	: m_Device( device )
+{
+	m_Slots.resize( maxFramesInFlight + 1 );
+}
+
+void GpuProfiler::BeginZone( nvrhi::ICommandList* commandList, const char* name )
+{
+	FrameSlot& slot = m_Slots[m_CurrentSlot];
+
+	PendingZone zone;
+	zone.name = name;
+	zone.depth = uint32_t( m_ZoneStack.size() );
+	zone.parent = m_ZoneStack.empty() ? NoParent : m_ZoneStack.back();
+	zone.query = allocateQuery();
+
+	commandList->beginTimerQuery( zone.query );
+
+	m_ZoneStack.push_back( uint32_t( slot.zones.size() ) );
+	slot.zones.push_back( std::move( zone ) );
+}
+
+void GpuProfiler::EndZone( nvrhi::ICommandList* commandList )
+{
+	assert( !m_ZoneStack.empty() && "GpuProfiler::EndZone without a matching BeginZone" );
+	if ( m_ZoneStack.empty() )
+		return;
+
+	const uint32_t zoneIndex = m_ZoneStack.back();
+	m_ZoneStack.pop_back();
+
+	commandList->endTimerQuery( m_Slots[m_CurrentSlot].zones[zoneIndex].query );
+}
+
+void GpuProfiler::EndFrame( uint64_t frameValue, uint64_t completedFrameValue )
+{
+	// A zone left open never gets its end timestamp, so the frame will end up dropped
+	m_ZoneStack.clear();
+
+	m_FrameCounter++;
+	if ( frameValue == 0 )
+	{
+		frameValue = m_FrameCounter;
+		completedFrameValue = 0;
+	}
+
+	FrameSlot& currentSlot = m_Slots[m_CurrentSlot];
+	currentSlot.frameValue = frameValue;
+	currentSlot.pending = !currentSlot.zones.empty();
+
+	// oldest first, so the latest timings end up being the newest resolved frame
+	const uint32_t numSlots = uint32_t( m_Slots.size() );
+	for ( uint32_t i = 1; i <= numSlots; i++ )
+	{
+		FrameSlot& slot = m_Slots[(m_CurrentSlot + i) % numSlots];
+		if ( slot.pending )
+		{
+			tryResolve( slot, completedFrameValue );
+		}
+	}
+
+	reclaimDroppedQueries();
+
+	m_CurrentSlot = (m_CurrentSlot + 1) % numSlots;
+
+	FrameSlot& nextSlot = m_Slots[m_CurrentSlot];
+	if ( nextSlot.pending )
+	{
+		dropSlot( nextSlot );
+		m_DroppedFrameCount++;
+	}
+}
+
+bool GpuProfiler::tryResolve( FrameSlot& slot, uint64_t completedFrameValue )
+{
+	// no point in polling queries of a frame the GPU isn't done with yet
+	if ( completedFrameValue != 0 && slot.frameValue > completedFrameValue )
+		return false;
+
+	for ( const PendingZone& zone : slot.zones )
+	{
+		if ( !m_Device->pollTimerQuery( zone.query ) )
+			return false;
+	}
+
+	m_LatestTimings.frameValue = slot.frameValue;
+	m_LatestTimings.zones.resize( slot.zones.size() );
+
+	for ( size_t i = 0; i < slot.zones.size(); i++ )
+	{
+		PendingZone& zone = slot.zones[i];
+		GpuZoneTiming& timing = m_LatestTimings.zones[i];
+
+		timing.name = zone.name;
+		timing.depth = zone.depth;
+		timing.parent = zone.parent;
+		timing.milliseconds = m_Device->getTimerQueryTime( zone.query ) * 1000.0f;
+
+		m_Device->resetTimerQuery( zone.query );
+		m_FreeQueries.push_back( std::move( zone.query ) );
+	}
+
+	slot.zones.clear();
+	slot.pending = false;
+
+	return true;
+}
+
+void GpuProfiler::dropSlot( FrameSlot& slot )
+{
+	// The GPU may still write into these queries, so they don't go back to the free list right away
+	for ( PendingZone& zone : slot.zones )
+	{
+		m_DroppedQueries.push_back( std::move( zone.query ) );
+	}
+
+	slot.zones.clear();
+	slot.pending = false;
+}
+
+void GpuProfiler::reclaimDroppedQueries()
+{
+	auto it = m_DroppedQueries.begin();
+	while ( it != m_DroppedQueries.end() )
+	{
+		if ( !m_Device->pollTimerQuery( *it ) )
+		{
+			++it;
+			continue;
+		}
+
+		m_Device->resetTimerQuery( *it );
+		m_FreeQueries.push_back( std::move( *it ) );
+		it = m_DroppedQueries.erase( it );
+	}
+}
+
+nvrhi::TimerQueryHandle GpuProfiler::allocateQuery()
+{
+	if ( m_FreeQueries.empty() )
+	{
+		m_QueryCount++;
+		return m_Device->createTimerQuery();
+	}
+
+	nvrhi::TimerQueryHandle query = std::move( m_FreeQueries.back() );
+	m_FreeQueries.pop_back();
+	return query;
+}
@@ -0,0 +1,385 @@
+#include "elegy-rhi/Logger.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace nvrhi::app;
+
+static_assert( (Logger::QueueSize & (Logger::QueueSize - 1)) == 0, "Logger::QueueSize must be a power of two" );
+
+// the Logger whose thread this is, if any
+static thread_local const Logger* t_ThreadLogger = nullptr;
+
+Logger::Logger()
+	: m_Cells( new Cell[QueueSize] )
+{
+	for ( uint32_t i = 0; i < QueueSize; i++ )
+	{
+		m_Cells[i].sequence.store( i, std::memory_order_relaxed );
+	}
+}
+
+Logger::~Logger()
+{
+	if ( !m_ThreadStarted.load( std::memory_order_acquire ) )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		m_Stop = true;
+	}
+	m_WakeCondition.notify_one();
+
+	m_Thread.join();
+}
+
+void Logger::startThread()
+{
+	std::call_once( m_ThreadStartFlag, [this]()
+		{
+			m_Thread = std::thread( &Logger::threadMain, this );
+			m_ThreadStarted.store( true, std::memory_order_release );
+		} );
+}
+
+bool Logger::isLoggingThread() const
+{
+	return t_ThreadLogger == this;
+}
+
+Logger::Cell* Logger::claimCell()
+{
+	// Device managers that never log don't need a thread
+	if ( !m_ThreadStarted.load( std::memory_order_acquire ) )
+	{
+		startThread();
+	}
+
+	uint64_t position = m_EnqueuePosition.load( std::memory_order_relaxed );
+	while ( true )
+	{
+		Cell* cell = &m_Cells[position & (QueueSize - 1)];
+		const uint64_t sequence = cell->sequence.load( std::memory_order_acquire );
+		const int64_t difference = int64_t( sequence ) - int64_t( position );
+
+		if ( difference == 0 )
+		{
+			if ( m_EnqueuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+				return cell;
+		}
+		else if ( difference < 0 )
+		{
+			// the consumer hasn't freed this slot yet, the queue is full
+			return nullptr;
+		}
+		else
+		{
+			position = m_EnqueuePosition.load( std::memory_order_relaxed );
+		}
+	}
+}
+
+Logger::Cell* Logger::waitForCell()
+{
+	while ( true )
+	{
+		if ( Cell* cell = claimCell() )
+			return cell;
+
+		std::this_thread::yield();
+	}
+}
+
+void Logger::publishCell( Cell* cell )
+{
+	const uint64_t position = cell->sequence.load( std::memory_order_relaxed );
+	cell->sequence.store( position + 1, std::memory_order_release );
+
+	wakeConsumer();
+}
+
+void Logger::dropMessage()
+{
+	// Nothing gets published, so without a wake-up the report would wait for the next message
+	m_DroppedMessages.fetch_add( 1, std::memory_order_relaxed );
+
+	wakeConsumer();
+}
+
+void Logger::wakeConsumer()
+{
+	// Pairs with the fence in threadMain: either the consumer sees the new message or drop
+	// before going to sleep, or we see that it is asleep and wake it up. Taking the lock
+	// makes sure it is actually waiting by the time we notify
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( m_ConsumerSleeping.load( std::memory_order_relaxed ) )
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		m_WakeCondition.notify_one();
+	}
+}
+
+bool Logger::hasWork() const
+{
+	const uint64_t position = m_DequeuePosition.load( std::memory_order_relaxed );
+	const Cell& next = m_Cells[position & (QueueSize - 1)];
+
+	return next.sequence.load( std::memory_order_acquire ) == position + 1
+		|| m_DroppedMessages.load( std::memory_order_relaxed ) != m_ReportedDroppedMessages;
+}
+
+void Logger::Flush()
+{
+	// nothing was ever logged, or we're in the callback
+	if ( !m_ThreadStarted.load( std::memory_order_acquire ) || isLoggingThread() )
+		return;
+
+	const uint64_t target = m_EnqueuePosition.load( std::memory_order_acquire );
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+	m_WakeCondition.notify_one();
+	m_DeliveredCondition.wait( lock, [&]()
+		{
+			return m_DequeuePosition.load( std::memory_order_acquire ) >= target;
+		} );
+}
+
+bool Logger::consume()
+{
+	bool consumed = false;
+
+	uint64_t position = m_DequeuePosition.load( std::memory_order_relaxed );
+	while ( true )
+	{
+		Cell& cell = m_Cells[position & (QueueSize - 1)];
+		if ( cell.sequence.load( std::memory_order_acquire ) != position + 1 )
+			break;
+
+		deliver( cell.record, m_FormatBuffer );
+
+		// only this thread dequeues, so there is nobody to race with
+		cell.sequence.store( position + QueueSize, std::memory_order_release );
+		position++;
+		m_DequeuePosition.store( position, std::memory_order_release );
+		consumed = true;
+	}
+
+	const uint64_t dropped = m_DroppedMessages.load( std::memory_order_relaxed );
+	if ( dropped != m_ReportedDroppedMessages && nullptr != m_LastCallback )
+	{
+		char message[128];
+		snprintf( message, sizeof( message ), "%llu log messages were dropped because the queue was full",
+			(unsigned long long)(dropped - m_ReportedDroppedMessages) );
+		m_LastCallback->message( nvrhi::MessageSeverity::Warning, message );
+		m_ReportedDroppedMessages = dropped;
+	}
+
+	return consumed;
+}
+
+// The value of one argument, converted to whatever the conversion character asks for
+struct ArgumentValue
+{
+	int64_t i = 0;
+	uint64_t u = 0;
+	double d = 0.0;
+	const void* p = nullptr;
+};
+
+// Appends one conversion. spec holds everything between the % and the conversion character,
+// minus the length modifiers, which are replaced by whatever fits the value
+static void FormatArgument( std::string& output, const std::string& spec, char conversion, const ArgumentValue& value )
+{
+	char format[32];
+	char buffer[128];
+	int length = 0;
+
+	switch ( conversion )
+	{
+	case 'd': case 'i':
+		snprintf( format, sizeof( format ), "%%%sll%c", spec.c_str(), conversion );
+		length = snprintf( buffer, sizeof( buffer ), format, (long long)value.i );
+		break;
+	case 'u': case 'x': case 'X': case 'o':
+		snprintf( format, sizeof( format ), "%%%sll%c", spec.c_str(), conversion );
+		length = snprintf( buffer, sizeof( buffer ), format, (unsigned long long)value.u );
+		break;
+	case 'c':
+		snprintf( format, sizeof( format ), "%%%sc", spec.c_str() );
+		length = snprintf( buffer, sizeof( buffer ), format, int( value.i ) );
+		break;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		snprintf( format, sizeof( format ), "%%%s%c", spec.c_str(), conversion );
+		length = snprintf( buffer, sizeof( buffer ), format, value.d );
+		break;
+	case 'p':
+		snprintf( format, sizeof( format ), "%%%sp", spec.c_str() );
+		length = snprintf( buffer, sizeof( buffer ), format, value.p );
+		break;
+	default:
+		output += "<bad format>";
+		return;
+	}
+
+	if ( length > 0 )
+	{
+		output.append( buffer, std::min<size_t>( size_t( length ), sizeof( buffer ) - 1 ) );
+	}
+}
+
+static void FormatString( std::string& output, const std::string& spec, const char* string, uint32_t length )
+{
+	if ( spec.empty() )
+	{
+		output.append( string, length );
+		return;
+	}
+
+	// the string isn't null-terminated, so width and precision are applied by hand
+	bool leftAlign = false;
+	int precision = -1;
+
+	const char* cursor = spec.c_str();
+	while ( *cursor == '-' || *cursor == '+' || *cursor == ' ' || *cursor == '#' || *cursor == '0' )
+	{
+		leftAlign |= *cursor == '-';
+		cursor++;
+	}
+
+	const int width = atoi( cursor );
+	if ( const char* dot = strchr( cursor, '.' ) )
+		precision = atoi( dot + 1 );
+
+	const uint32_t printed = (precision >= 0) ? std::min( length, uint32_t( precision ) ) : length;
+	const size_t padding = (width > int( printed )) ? size_t( width - int( printed ) ) : 0;
+
+	if ( !leftAlign )
+		output.append( padding, ' ' );
+	output.append( string, printed );
+	if ( leftAlign )
+		output.append( padding, ' ' );
+}
+
+void Logger::deliver( Record& record, std::string& buffer )
+{
+	m_LastCallback = record.callback;
+
+	buffer.clear();
+	std::string spec;
+	uint32_t argumentIndex = 0;
+
+	for ( const char* cursor = record.format; *cursor; cursor++ )
+	{
+		if ( *cursor != '%' )
+		{
+			buffer += *cursor;
+			continue;
+		}
+
+		cursor++;
+		if ( *cursor == '%' )
+		{
+			buffer += '%';
+			continue;
+		}
+
+		// flags, width and precision are kept, length modifiers are dropped
+		spec.clear();
+		while ( *cursor && strchr( "-+ #0123456789.", *cursor ) )
+			spec += *cursor++;
+		while ( *cursor && strchr( "hlLqjzt", *cursor ) )
+			cursor++;
+
+		if ( !*cursor )
+			break;
+
+		if ( argumentIndex >= record.numArguments )
+		{
+			buffer += "<missing>";
+			continue;
+		}
+
+		const Argument& argument = record.arguments[argumentIndex++];
+		if ( argument.type == Argument::String )
+		{
+			if ( *cursor == 's' )
+				FormatString( buffer, spec, argument.s, argument.length );
+			else
+				buffer += "<bad format>";
+		}
+		else
+		{
+			ArgumentValue value;
+			switch ( argument.type )
+			{
+			case Argument::Signed:
+				value.i = argument.i;
+				value.u = uint64_t( argument.i );
+				value.d = double( argument.i );
+				break;
+			case Argument::Unsigned:
+				value.u = argument.u;
+				value.i = int64_t( argument.u );
+				value.d = double( argument.u );
+				break;
+			case Argument::Double:
+				value.d = argument.d;
+				value.i = int64_t( argument.d );
+				value.u = uint64_t( value.i );
+				break;
+			default:
+				value.u = uint64_t( uintptr_t( argument.p ) );
+				value.i = int64_t( value.u );
+				break;
+			}
+			value.p = reinterpret_cast<const void*>( uintptr_t( value.u ) );
+
+			FormatArgument( buffer, spec, *cursor, value );
+		}
+	}
+
+	for ( uint32_t i = 0; i < record.numArguments; i++ )
+	{
+		if ( record.arguments[i].owned )
+			delete[] record.arguments[i].s;
+	}
+
+	record.callback->message( record.severity, buffer.c_str() );
+}
+
+void Logger::threadMain()
+{
+	t_ThreadLogger = this;
+
+	while ( true )
+	{
+		if ( consume() )
+		{
+			// lock so Flush can't miss the notification between checking and waiting
+			{
+				std::lock_guard<std::mutex> lock( m_Mutex );
+			}
+			m_DeliveredCondition.notify_all();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_Mutex );
+		m_DeliveredCondition.notify_all();
+
+		// Messages still being written by a producer keep us going, even when stopping
+		if ( m_Stop && m_DequeuePosition.load( std::memory_order_relaxed ) == m_EnqueuePosition.load( std::memory_order_acquire ) )
+			break;
+
+		m_ConsumerSleeping.store( true, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+
+		// No timeout needed, anything published or dropped after this check comes with a wake-up, see wakeConsumer
+		m_WakeCondition.wait( lock, [this]()
+			{
+				return m_Stop || hasWork();
+			} );
+
+		m_ConsumerSleeping.store( false, std::memory_order_relaxed );
+	}
+}
@@ -0,0 +1,316 @@
+#include "elegy-rhi/Trace.hpp"
+
+#include "FileUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace nvrhi::app;
+
+#if ELR_ENABLE_TRACE
+
+static_assert( (Trace::EventsPerThread & (Trace::EventsPerThread - 1)) == 0, "Trace::EventsPerThread must be a power of two" );
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t id = 0;
+		std::string name;
+		TraceEvent events[Trace::EventsPerThread];
+		// events ever recorded, the next one goes into events[count % EventsPerThread]
+		std::atomic<uint64_t> count{ 0 };
+	};
+
+	// Buffers stay around after their thread exits, so exports still see what it recorded
+	struct ThreadRegistry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	ThreadRegistry& GetRegistry()
+	{
+		static ThreadRegistry registry;
+		return registry;
+	}
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if ( nullptr == buffer )
+		{
+			ThreadRegistry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock( registry.mutex );
+
+			registry.buffers.push_back( std::make_unique<ThreadBuffer>() );
+			buffer = registry.buffers.back().get();
+			buffer->id = uint32_t( registry.buffers.size() );
+			buffer->name = "Thread " + std::to_string( buffer->id );
+		}
+
+		return *buffer;
+	}
+
+	struct ThreadEvents
+	{
+		uint32_t id;
+		std::string name;
+		// sorted by begin, enclosing events before the ones they contain
+		std::vector<TraceEvent> events;
+	};
+
+	std::vector<ThreadEvents> CollectEvents()
+	{
+		std::vector<ThreadEvents> threads;
+
+		ThreadRegistry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock( registry.mutex );
+
+		for ( const auto& buffer : registry.buffers )
+		{
+			const uint64_t count = buffer->count.load( std::memory_order_acquire );
+			const uint64_t first = (count > Trace::EventsPerThread) ? count - Trace::EventsPerThread : 0;
+
+			ThreadEvents thread{ buffer->id, buffer->name, {} };
+			for ( uint64_t i = first; i < count; i++ )
+			{
+				thread.events.push_back( buffer->events[i & (Trace::EventsPerThread - 1)] );
+			}
+
+			std::sort( thread.events.begin(), thread.events.end(), []( const TraceEvent& a, const TraceEvent& b )
+				{
+					return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+				} );
+
+			threads.push_back( std::move( thread ) );
+		}
+
+		return threads;
+	}
+
+	void AppendJsonString( std::string& output, const char* text )
+	{
+		output += '"';
+		for ( ; *text; text++ )
+		{
+			if ( *text == '"' || *text == '\\' )
+				output += '\\';
+			if ( uint8_t( *text ) >= 0x20 )
+				output += *text;
+		}
+		output += '"';
+	}
+
+	// Just enough of the protobuf wire format for the Perfetto messages below
+	void AppendVarint( std::string& output, uint64_t value )
+	{
+		while ( value >= 0x80 )
+		{
+			output += char( (value & 0x7f) | 0x80 );
+			value >>= 7;
+		}
+		output += char( value );
+	}
+
+	void AppendVarintField( std::string& output, uint32_t field, uint64_t value )
+	{
+		AppendVarint( output, (uint64_t( field ) << 3) | 0 );
+		AppendVarint( output, value );
+	}
+
+	void AppendBytesField( std::string& output, uint32_t field, const std::string& bytes )
+	{
+		AppendVarint( output, (uint64_t( field ) << 3) | 2 );
+		AppendVarint( output, bytes.size() );
+		output += bytes;
+	}
+
+	// Field numbers from perfetto/protos/perfetto/trace/
+	namespace Proto
+	{
+		constexpr uint32_t TracePacket = 1;
+
+		constexpr uint32_t PacketTimestamp = 8;
+		constexpr uint32_t PacketSequenceId = 10;
+		constexpr uint32_t PacketTrackEvent = 11;
+		constexpr uint32_t PacketTrackDescriptor = 60;
+
+		constexpr uint32_t TrackEventType = 9;
+		constexpr uint32_t TrackEventTrackUuid = 11;
+		constexpr uint32_t TrackEventName = 23;
+		constexpr uint64_t TypeSliceBegin = 1;
+		constexpr uint64_t TypeSliceEnd = 2;
+
+		constexpr uint32_t TrackDescriptorUuid = 1;
+		constexpr uint32_t TrackDescriptorName = 2;
+		constexpr uint32_t TrackDescriptorThread = 4;
+
+		constexpr uint32_t ThreadDescriptorPid = 1;
+		constexpr uint32_t ThreadDescriptorTid = 2;
+	}
+
+	constexpr uint64_t TracePid = 1;
+	constexpr uint32_t TraceSequenceId = 1;
+
+	void AppendSlicePacket( std::string& output, uint64_t timestamp, uint64_t trackUuid, uint64_t type, const char* name )
+	{
+		std::string trackEvent;
+		AppendVarintField( trackEvent, Proto::TrackEventType, type );
+		AppendVarintField( trackEvent, Proto::TrackEventTrackUuid, trackUuid );
+		if ( nullptr != name )
+		{
+			AppendBytesField( trackEvent, Proto::TrackEventName, name );
+		}
+
+		std::string packet;
+		AppendVarintField( packet, Proto::PacketTimestamp, timestamp );
+		AppendVarintField( packet, Proto::PacketSequenceId, TraceSequenceId );
+		AppendBytesField( packet, Proto::PacketTrackEvent, trackEvent );
+
+		AppendBytesField( output, Proto::TracePacket, packet );
+	}
+}
+
+void Trace::SetThreadName( const char* name )
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock( GetRegistry().mutex );
+	buffer.name = name;
+}
+
+void Trace::Clear()
+{
+	ThreadRegistry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock( registry.mutex );
+
+	for ( const auto& buffer : registry.buffers )
+	{
+		buffer->count.store( 0, std::memory_order_release );
+	}
+}
+
+void Trace::Record( const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds )
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	const uint64_t index = buffer.count.load( std::memory_order_relaxed );
+	buffer.events[index & (EventsPerThread - 1)] = { name, beginNanoseconds, endNanoseconds };
+	buffer.count.store( index + 1, std::memory_order_release );
+}
+
+bool Trace::WriteChromeJson( const std::string& path )
+{
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	char line[256];
+
+	for ( const ThreadEvents& thread : CollectEvents() )
+	{
+		snprintf( line, sizeof( line ), "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%llu,\"tid\":%u,\"args\":{\"name\":",
+			first ? "" : ",", (unsigned long long)TracePid, thread.id );
+		json += line;
+		AppendJsonString( json, thread.name.c_str() );
+		json += "}}";
+		first = false;
+
+		for ( const TraceEvent& event : thread.events )
+		{
+			json += ",\n{\"ph\":\"X\",\"name\":";
+			AppendJsonString( json, event.name );
+			snprintf( line, sizeof( line ), ",\"pid\":%llu,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				(unsigned long long)TracePid, thread.id, double( event.begin ) / 1000.0, double( event.end - event.begin ) / 1000.0 );
+			json += line;
+		}
+	}
+
+	json += "\n]}\n";
+
+	return WriteFileAtomically( path, json.data(), json.size() );
+}
+
+bool Trace::WritePerfetto( const std::string& path )
+{
+	std::string trace;
+
+	for ( const ThreadEvents& thread : CollectEvents() )
+	{
+		const uint64_t trackUuid = thread.id;
+
+		std::string threadDescriptor;
+		AppendVarintField( threadDescriptor, Proto::ThreadDescriptorPid, TracePid );
+		AppendVarintField( threadDescriptor, Proto::ThreadDescriptorTid, thread.id );
+
+		std::string trackDescriptor;
+		AppendVarintField( trackDescriptor, Proto::TrackDescriptorUuid, trackUuid );
+		AppendBytesField( trackDescriptor, Proto::TrackDescriptorName, thread.name );
+		AppendBytesField( trackDescriptor, Proto::TrackDescriptorThread, threadDescriptor );
+
+		std::string packet;
+		AppendVarintField( packet, Proto::PacketSequenceId, TraceSequenceId );
+		AppendBytesField( packet, Proto::PacketTrackDescriptor, trackDescriptor );
+		AppendBytesField( trace, Proto::TracePacket, packet );
+
+		// Slices on a track have to be properly nested and in order, so ends
+		// are emitted as soon as the next begin is past them
+		std::vector<uint64_t> openEnds;
+		for ( const TraceEvent& event : thread.events )
+		{
+			while ( !openEnds.empty() && openEnds.back() <= event.begin )
+			{
+				AppendSlicePacket( trace, openEnds.back(), trackUuid, Proto::TypeSliceEnd, nullptr );
+				openEnds.pop_back();
+			}
+
+			AppendSlicePacket( trace, event.begin, trackUuid, Proto::TypeSliceBegin, event.name );
+			// a torn event can't end after its parent
+			openEnds.push_back( openEnds.empty() ? event.end : std::min( event.end, openEnds.back() ) );
+		}
+
+		while ( !openEnds.empty() )
+		{
+			AppendSlicePacket( trace, openEnds.back(), trackUuid, Proto::TypeSliceEnd, nullptr );
+			openEnds.pop_back();
+		}
+	}
+
+	return WriteFileAtomically( path, trace.data(), trace.size() );
+}
+
+#else
+
+void Trace::SetThreadName( const char* name )
+{
+}
+
+void Trace::Clear()
+{
+}
+
+void Trace::Record( const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds )
+{
+}
+
+bool Trace::WriteChromeJson( const std::string& path )
+{
+	return false;
+}
+
+bool Trace::WritePerfetto( const std::string& path )
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include "VulkanHostAllocator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace nvrhi::app;
+
+static const char* GetScopeName( uint32_t scope )
+{
+	switch ( scope )
+	{
+	case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+	case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+	case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+	case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+	case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+	}
+
+	return "unknown";
+}
+
+VulkanHostAllocator::VulkanHostAllocator()
+{
+	m_Callbacks.pUserData = this;
+	m_Callbacks.pfnAllocation = &Allocate;
+	m_Callbacks.pfnReallocation = &Reallocate;
+	m_Callbacks.pfnFree = &Free;
+	m_Callbacks.pfnInternalAllocation = &InternalAllocation;
+	m_Callbacks.pfnInternalFree = &InternalFree;
+}
+
+VulkanHostAllocator::~VulkanHostAllocator()
+{
+	for ( Pool& pool : m_Pools )
+	{
+		for ( void* slab : pool.slabs )
+			std::free( slab );
+	}
+}
+
+VulkanHostAllocator::ScopeStats VulkanHostAllocator::GetStats( VkSystemAllocationScope scope ) const
+{
+	ScopeStats stats;
+	if ( uint32_t( scope ) >= NumScopes )
+		return stats;
+
+	const ScopeCounters& counters = m_Scopes[scope];
+	stats.liveAllocations = counters.liveAllocations.load( std::memory_order_relaxed );
+	stats.liveBytes = counters.liveBytes.load( std::memory_order_relaxed );
+	stats.peakBytes = counters.peakBytes.load( std::memory_order_relaxed );
+	stats.totalAllocations = counters.totalAllocations.load( std::memory_order_relaxed );
+	stats.liveInternalBytes = counters.liveInternalBytes.load( std::memory_order_relaxed );
+
+	return stats;
+}
+
+std::string VulkanHostAllocator::GetReport() const
+{
+	std::string report = "Vulkan host memory by allocation scope:";
+
+	char line[256];
+	for ( uint32_t scope = 0; scope < NumScopes; scope++ )
+	{
+		const ScopeStats stats = GetStats( VkSystemAllocationScope( scope ) );
+		snprintf( line, sizeof( line ), "\n    %-8s %llu live allocations, %llu bytes (peak %llu), %llu internal bytes, %llu allocations in total",
+			GetScopeName( scope ),
+			(unsigned long long)stats.liveAllocations, (unsigned long long)stats.liveBytes,
+			(unsigned long long)stats.peakBytes, (unsigned long long)stats.liveInternalBytes,
+			(unsigned long long)stats.totalAllocations );
+
+		report += line;
+	}
+
+	return report;
+}
+
+void* VulkanHostAllocator::allocateBlock( uint32_t sizeClass )
+{
+	const size_t blockSize = MinBlockSize << sizeClass;
+	Pool& pool = m_Pools[sizeClass];
+
+	std::lock_guard<std::mutex> lock( pool.mutex );
+
+	if ( pool.freeBlocks.empty() )
+	{
+		char* slab = static_cast<char*>( std::malloc( SlabSize ) );
+		if ( nullptr == slab )
+			return nullptr;
+
+		pool.slabs.push_back( slab );
+		for ( size_t offset = 0; offset + blockSize <= SlabSize; offset += blockSize )
+		{
+			pool.freeBlocks.push_back( slab + offset );
+		}
+	}
+
+	void* block = pool.freeBlocks.back();
+	pool.freeBlocks.pop_back();
+
+	return block;
+}
+
+void VulkanHostAllocator::freeBlock( uint32_t sizeClass, void* block )
+{
+	Pool& pool = m_Pools[sizeClass];
+
+	std::lock_guard<std::mutex> lock( pool.mutex );
+	pool.freeBlocks.push_back( block );
+}
+
+void* VulkanHostAllocator::allocate( size_t size, size_t alignment, VkSystemAllocationScope scope )
+{
+	if ( size == 0 || uint32_t( scope ) >= NumScopes )
+		return nullptr;
+
+	// Slabs and malloc are aligned to at least 16 bytes, which covers the header,
+	// and leaves the user data aligned as long as we add enough padding
+	alignment = std::max<size_t>( alignment, alignof( Header ) );
+	const size_t totalSize = size + sizeof( Header ) + alignment - 1;
+
+	uint32_t sizeClass = 0;
+	while ( sizeClass < NumSizeClasses && (MinBlockSize << sizeClass) < totalSize )
+	{
+		sizeClass++;
+	}
+
+	void* block = nullptr;
+	if ( sizeClass < NumSizeClasses )
+	{
+		block = allocateBlock( sizeClass );
+	}
+	else
+	{
+		sizeClass = Unpooled;
+		block = std::malloc( totalSize );
+	}
+
+	if ( nullptr == block )
+		return nullptr;
+
+	const uintptr_t userAddress = (uintptr_t( block ) + sizeof( Header ) + alignment - 1) & ~uintptr_t( alignment - 1 );
+	void* memory = reinterpret_cast<void*>( userAddress );
+
+	Header header;
+	header.block = block;
+	header.size = size;
+	header.sizeClass = sizeClass;
+	header.scope = uint32_t( scope );
+	std::memcpy( static_cast<char*>( memory ) - sizeof( Header ), &header, sizeof( Header ) );
+
+	ScopeCounters& counters = m_Scopes[scope];
+	counters.liveAllocations.fetch_add( 1, std::memory_order_relaxed );
+	counters.totalAllocations.fetch_add( 1, std::memory_order_relaxed );
+	const uint64_t liveBytes = counters.liveBytes.fetch_add( size, std::memory_order_relaxed ) + size;
+
+	uint64_t peakBytes = counters.peakBytes.load( std::memory_order_relaxed );
+	while ( liveBytes > peakBytes && !counters.peakBytes.compare_exchange_weak( peakBytes, liveBytes, std::memory_order_relaxed ) )
+	{
+	}
+
+	return memory;
+}
+
+void VulkanHostAllocator::free( void* memory )
+{
+	if ( nullptr == memory )
+		return;
+
+	Header header;
+	std::memcpy( &header, static_cast<char*>( memory ) - sizeof( Header ), sizeof( Header ) );
+
+	ScopeCounters& counters = m_Scopes[header.scope];
+	counters.liveAllocations.fetch_sub( 1, std::memory_order_relaxed );
+	counters.liveBytes.fetch_sub( header.size, std::memory_order_relaxed );
+
+	if ( header.sizeClass == Unpooled )
+		std::free( header.block );
+	else
+		freeBlock( header.sizeClass, header.block );
+}
+
+void* VulkanHostAllocator::reallocate( void* original, size_t size, size_t alignment, VkSystemAllocationScope scope )
+{
+	// As the spec wants: null behaves like allocate, size 0 like free
+	if ( nullptr == original )
+		return allocate( size, alignment, scope );
+
+	if ( size == 0 )
+	{
+		free( original );
+		return nullptr;
+	}
+
+	Header header;
+	std::memcpy( &header, static_cast<char*>( original ) - sizeof( Header ), sizeof( Header ) );
+
+	void* memory = allocate( size, alignment, scope );
+	if ( nullptr == memory )
+		return nullptr;
+
+	std::memcpy( memory, original, std::min( size, header.size ) );
+	free( original );
+
+	return memory;
+}
+
+void* VulkanHostAllocator::Allocate( void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope )
+{
+	return static_cast<VulkanHostAllocator*>( userData )->allocate( size, alignment, scope );
+}
+
+void* VulkanHostAllocator::Reallocate( void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope )
+{
+	return static_cast<VulkanHostAllocator*>( userData )->reallocate( original, size, alignment, scope );
+}
+
+void VulkanHostAllocator::Free( void* userData, void* memory )
+{
+	static_cast<VulkanHostAllocator*>( userData )->free( memory );
+}
+
+void VulkanHostAllocator::InternalAllocation( void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope )
+{
+	if ( uint32_t( scope ) < NumScopes )
+	{
+		static_cast<VulkanHostAllocator*>( userData )->m_Scopes[scope].liveInternalBytes.fetch_add( size, std::memory_order_relaxed );
+	}
+}
+
+void VulkanHostAllocator::InternalFree( void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope )
+{
+	if ( uint32_t( scope ) < NumScopes )
+	{
+		static_cast<VulkanHostAllocator*>( userData )->m_Scopes[scope].liveInternalBytes.fetch_sub( size, std::memory_order_relaxed );
+	}
+}
@@ -0,0 +1,98 @@
+// VkAllocationCallbacks for the Vulkan backend, not part of the public API
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nvrhi::app
+{
+	// Host memory for the Vulkan driver and loader. Small allocations come out of size-class pools,
+	// which are much cheaper than malloc for the tiny, short-lived objects drivers like to allocate,
+	// and everything is counted per VkSystemAllocationScope so leaks and bloat can be told apart by category.
+	// The callbacks are thread-safe. Pooled memory is only handed back to the OS when the allocator goes away,
+	// so it has to outlive every object created with it.
+	class VulkanHostAllocator
+	{
+	public:
+		struct ScopeStats
+		{
+			uint64_t liveAllocations = 0;
+			uint64_t liveBytes = 0;
+			uint64_t peakBytes = 0;
+			uint64_t totalAllocations = 0;
+			// memory the driver got elsewhere and told us about (vkInternalAllocationNotification)
+			uint64_t liveInternalBytes = 0;
+		};
+
+		static constexpr uint32_t NumScopes = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+		VulkanHostAllocator();
+		~VulkanHostAllocator();
+
+		VulkanHostAllocator( const VulkanHostAllocator& ) = delete;
+		VulkanHostAllocator& operator=( const VulkanHostAllocator& ) = delete;
+
+		[[nodiscard]] VkAllocationCallbacks* GetCallbacks() { return &m_Callbacks; }
+
+		[[nodiscard]] ScopeStats GetStats( VkSystemAllocationScope scope ) const;
+		// One line per scope, for ReportLiveObjects
+		[[nodiscard]] std::string GetReport() const;
+
+	private:
+		// Every allocation is preceded by one of these, right before the pointer handed out
+		struct Header
+		{
+			void* block;
+			size_t size;
+			uint32_t sizeClass;
+			uint32_t scope;
+		};
+
+		struct Pool
+		{
+			std::mutex mutex;
+			std::vector<void*> freeBlocks;
+			std::vector<void*> slabs;
+		};
+
+		struct ScopeCounters
+		{
+			std::atomic<uint64_t> liveAllocations{ 0 };
+			std::atomic<uint64_t> liveBytes{ 0 };
+			std::atomic<uint64_t> peakBytes{ 0 };
+			std::atomic<uint64_t> totalAllocations{ 0 };
+			std::atomic<uint64_t> liveInternalBytes{ 0 };
+		};
+
+		// 32 bytes to 4 KiB in powers of two, anything bigger goes straight to malloc
+		static constexpr uint32_t NumSizeClasses = 8;
+		static constexpr size_t MinBlockSize = 32;
+		static constexpr size_t SlabSize = 64 * 1024;
+		static constexpr uint32_t Unpooled = ~0u;
+
+		void* allocate( size_t size, size_t alignment, VkSystemAllocationScope scope );
+		void* reallocate( void* original, size_t size, size_t alignment, VkSystemAllocationScope scope );
+		void free( void* memory );
+
+		void* allocateBlock( uint32_t sizeClass );
+		void freeBlock( uint32_t sizeClass, void* block );
+
+		static VKAPI_ATTR void* VKAPI_CALL Allocate( void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope );
+		static VKAPI_ATTR void* VKAPI_CALL Reallocate( void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope );
+		static VKAPI_ATTR void VKAPI_CALL Free( void* userData, void* memory );
+		static VKAPI_ATTR void VKAPI_CALL InternalAllocation( void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope );
+		static VKAPI_ATTR void VKAPI_CALL InternalFree( void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope );
+
+		VkAllocationCallbacks m_Callbacks{};
+		std::array<Pool, NumSizeClasses> m_Pools;
+		std::array<ScopeCounters, NumScopes> m_Scopes;
+	};
+}
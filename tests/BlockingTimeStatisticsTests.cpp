@@ -0,0 +1,90 @@
+#include "elegy-rhi/BlockingTimeStatistics.hpp"
+
+#include "Test.hpp"
+
+using namespace nvrhi::app;
+using nvrhi::app::test::IsNear;
+
+ELR_TEST( EmptyHistogram )
+{
+	BlockingTimeHistogram histogram;
+	ELR_CHECK( histogram.GetTotalCount() == 0 );
+	ELR_CHECK( histogram.GetTotalSeconds() == 0.0 );
+	ELR_CHECK( histogram.GetMaxSeconds() == 0.0 );
+	ELR_CHECK( histogram.GetPercentile( 0.5 ) == 0.0 );
+}
+
+ELR_TEST( BucketsArePowersOfTwoMicroseconds )
+{
+	BlockingTimeHistogram histogram;
+	histogram.AddSample( 500 );    // under 1us
+	histogram.AddSample( 1'000 );  // 1us
+	histogram.AddSample( 1'999 );  // still 1us
+	histogram.AddSample( 2'000 );  // 2us
+	histogram.AddSample( 3'999 );  // 3us
+	histogram.AddSample( 4'000 );  // 4us
+
+	ELR_CHECK( histogram.GetBucketCount( 0 ) == 1 );
+	ELR_CHECK( histogram.GetBucketCount( 1 ) == 2 );
+	ELR_CHECK( histogram.GetBucketCount( 2 ) == 2 );
+	ELR_CHECK( histogram.GetBucketCount( 3 ) == 1 );
+	ELR_CHECK( histogram.GetTotalCount() == 6 );
+
+	ELR_CHECK( IsNear( histogram.GetBucketUpperBound( 0 ), 1e-6 ) );
+	ELR_CHECK( IsNear( histogram.GetBucketUpperBound( 3 ), 8e-6 ) );
+}
+
+ELR_TEST( LongWaitsGoToTheLastBucket )
+{
+	BlockingTimeHistogram histogram;
+	histogram.AddSample( 10'000'000'000ull ); // 10s
+
+	const uint32_t lastBucket = BlockingTimeHistogram::NumBuckets - 1;
+	ELR_CHECK( histogram.GetBucketCount( lastBucket ) == 1 );
+	// reports the longest sample instead of infinity
+	ELR_CHECK( IsNear( histogram.GetBucketUpperBound( lastBucket ), 10.0 ) );
+}
+
+ELR_TEST( TotalsAndMax )
+{
+	BlockingTimeHistogram histogram;
+	histogram.AddSample( 1'000'000 );
+	histogram.AddSample( 3'000'000 );
+	histogram.AddSample( 2'000'000 );
+
+	ELR_CHECK( IsNear( histogram.GetTotalSeconds(), 6e-3 ) );
+	ELR_CHECK( IsNear( histogram.GetMaxSeconds(), 3e-3 ) );
+}
+
+ELR_TEST( PercentilesReportBucketBounds )
+{
+	BlockingTimeHistogram histogram;
+	for ( int i = 0; i < 99; i++ )
+		histogram.AddSample( 1'500 );
+	histogram.AddSample( 1'000'000 );
+
+	// the top of the 1us bucket
+	ELR_CHECK( IsNear( histogram.GetPercentile( 0.5 ), 2e-6 ) );
+	ELR_CHECK( IsNear( histogram.GetPercentile( 0.99 ), 2e-6 ) );
+	// capped at the longest sample rather than the top of its bucket
+	ELR_CHECK( IsNear( histogram.GetPercentile( 1.0 ), 1e-3 ) );
+	// out of range fractions are clamped
+	ELR_CHECK( IsNear( histogram.GetPercentile( 2.0 ), 1e-3 ) );
+	ELR_CHECK( IsNear( histogram.GetPercentile( -1.0 ), 2e-6 ) );
+}
+
+ELR_TEST( Reset )
+{
+	BlockingTimeHistogram histogram;
+	histogram.AddSample( 1'000 );
+	histogram.AddSample( 1'000'000 );
+	histogram.Reset();
+
+	ELR_CHECK( histogram.GetTotalCount() == 0 );
+	ELR_CHECK( histogram.GetTotalSeconds() == 0.0 );
+	ELR_CHECK( histogram.GetMaxSeconds() == 0.0 );
+	for ( uint32_t bucket = 0; bucket < BlockingTimeHistogram::NumBuckets; bucket++ )
+		ELR_CHECK( histogram.GetBucketCount( bucket ) == 0 );
+}
+
+ELR_TEST_MAIN()
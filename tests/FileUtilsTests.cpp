@@ -0,0 +1,87 @@
+#include "FileUtils.hpp"
+
+#include "Test.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	std::string GetTestPath( const char* name )
+	{
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	std::string ReadFile( const std::string& path )
+	{
+		std::ifstream file( path, std::ios::binary );
+		std::stringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+}
+
+ELR_TEST( WritesNewFiles )
+{
+	const std::string path = GetTestPath( "elegy-rhi-file-utils-new.bin" );
+	std::filesystem::remove( path );
+
+	const char data[] = "hello\0world";
+	ELR_CHECK( WriteFileAtomically( path, data, sizeof( data ) ) );
+	ELR_CHECK( ReadFile( path ) == std::string( data, sizeof( data ) ) );
+
+	std::filesystem::remove( path );
+}
+
+ELR_TEST( ReplacesExistingFiles )
+{
+	const std::string path = GetTestPath( "elegy-rhi-file-utils-replace.txt" );
+
+	const std::string first( 4096, 'a' );
+	const std::string second = "short";
+	ELR_CHECK( WriteFileAtomically( path, first.data(), first.size() ) );
+	ELR_CHECK( WriteFileAtomically( path, second.data(), second.size() ) );
+	ELR_CHECK( ReadFile( path ) == second );
+
+	// nothing of the temporary file is left behind
+	size_t numFiles = 0;
+	for ( const auto& entry : std::filesystem::directory_iterator( std::filesystem::path( path ).parent_path() ) )
+	{
+		if ( entry.path().filename().string().rfind( "elegy-rhi-file-utils-replace.txt", 0 ) == 0 )
+			numFiles++;
+	}
+	ELR_CHECK( numFiles == 1 );
+
+	std::filesystem::remove( path );
+}
+
+ELR_TEST( FailsWithoutTheDirectory )
+{
+	const std::string path = GetTestPath( "elegy-rhi-no-such-directory/file.txt" );
+	ELR_CHECK( !WriteFileAtomically( path, "x", 1 ) );
+}
+
+ELR_TEST( MapsWhatWasWritten )
+{
+	const std::string path = GetTestPath( "elegy-rhi-file-utils-mapped.bin" );
+	const std::string contents = "mapped contents";
+	ELR_CHECK( WriteFileAtomically( path, contents.data(), contents.size() ) );
+
+	{
+		MappedFile file;
+		ELR_CHECK( file.Open( path ) );
+		ELR_CHECK( file.GetSize() == contents.size() );
+		ELR_CHECK( file.GetData() && memcmp( file.GetData(), contents.data(), contents.size() ) == 0 );
+	}
+
+	std::filesystem::remove( path );
+
+	MappedFile missing;
+	ELR_CHECK( !missing.Open( path ) );
+}
+
+ELR_TEST_MAIN()
@@ -0,0 +1,93 @@
+// Frame pacing on the frame timeline semaphore, on headless Vulkan. A software ICD like lavapipe is enough,
+// skipped when no Vulkan device can be created
+
+#include "elegy-rhi/DeviceManager.hpp"
+
+#include "Test.hpp"
+
+#include <memory>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	std::unique_ptr<DeviceManager> CreateHeadlessVulkanDevice( uint32_t maxFramesInFlight )
+	{
+		DeviceCreationParameters params;
+		params.headless = true;
+		params.backBufferWidth = 1024;
+		params.backBufferHeight = 1024;
+		params.maxFramesInFlight = maxFramesInFlight;
+
+		std::unique_ptr<DeviceManager> deviceManager( DeviceManager::Create( nvrhi::GraphicsAPI::VULKAN ) );
+		if ( !deviceManager || !deviceManager->CreateWindowDeviceAndSwapChain( params ) )
+			return nullptr;
+
+		return deviceManager;
+	}
+
+	// Clears the back buffer a few times over, so frames take the GPU a moment and actually queue up
+	void RunFrame( DeviceManager& deviceManager, nvrhi::ICommandList* commandList )
+	{
+		deviceManager.BeginFrame();
+
+		commandList->open();
+		for ( int i = 0; i < 8; i++ )
+		{
+			commandList->clearTextureFloat( deviceManager.GetCurrentBackBuffer(), nvrhi::AllSubresources, nvrhi::Color( float( i ) / 8.0f ) );
+		}
+		commandList->close();
+		deviceManager.GetDevice()->executeCommandList( commandList );
+
+		deviceManager.Present();
+	}
+
+	void CheckPacing( uint32_t maxFramesInFlight )
+	{
+		std::unique_ptr<DeviceManager> deviceManager = CreateHeadlessVulkanDevice( maxFramesInFlight );
+		if ( !deviceManager )
+			ELR_SKIP( "no Vulkan device" );
+
+		nvrhi::IDevice* device = deviceManager->GetDevice();
+		nvrhi::CommandListHandle commandList = device->createCommandList();
+
+		ELR_CHECK( deviceManager->GetCurrentFrameValue() == 0 );
+
+		uint64_t previousCompleted = 0;
+		for ( uint64_t frame = 1; frame <= 30; frame++ )
+		{
+			RunFrame( *deviceManager, commandList );
+
+			const uint64_t current = deviceManager->GetCurrentFrameValue();
+			const uint64_t completed = deviceManager->GetCompletedFrameValue();
+			ELR_CHECK( current == frame );
+			ELR_CHECK( completed <= current );
+			ELR_CHECK( completed >= previousCompleted );
+			// Present returns once at most maxFramesInFlight frames are unfinished
+			ELR_CHECK( current - completed <= maxFramesInFlight );
+			previousCompleted = completed;
+		}
+
+		device->waitForIdle();
+		ELR_CHECK( deviceManager->GetCompletedFrameValue() == deviceManager->GetCurrentFrameValue() );
+
+		deviceManager->Shutdown();
+	}
+}
+
+ELR_TEST( OneFrameInFlight )
+{
+	CheckPacing( 1 );
+}
+
+ELR_TEST( TwoFramesInFlight )
+{
+	CheckPacing( 2 );
+}
+
+ELR_TEST( ThreeFramesInFlight )
+{
+	CheckPacing( 3 );
+}
+
+ELR_TEST_MAIN()
@@ -0,0 +1,137 @@
+#include "elegy-rhi/FrameTimeStatistics.hpp"
+
+#include "Test.hpp"
+
+#include <thread>
+
+using namespace nvrhi::app;
+using nvrhi::app::test::IsNear;
+
+// samples are stored as floats
+static constexpr double Tolerance = 1e-6;
+
+ELR_TEST( NoSamples )
+{
+	FrameTimeStatistics statistics;
+	FrameTimeSummary summary;
+	ELR_CHECK( !statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.totalFrames == 0 );
+}
+
+ELR_TEST( Summary )
+{
+	FrameTimeStatistics statistics;
+	for ( int i = 1; i <= 100; i++ )
+		statistics.AddSample( i * 0.001 );
+
+	FrameTimeSummary summary;
+	ELR_CHECK( statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.numFrames == 100 );
+	ELR_CHECK( summary.totalFrames == 100 );
+	ELR_CHECK( IsNear( summary.min, 0.001, Tolerance ) );
+	ELR_CHECK( IsNear( summary.max, 0.100, Tolerance ) );
+	ELR_CHECK( IsNear( summary.mean, 0.0505, Tolerance ) );
+	// nearest rank
+	ELR_CHECK( IsNear( summary.p50, 0.050, Tolerance ) );
+	ELR_CHECK( IsNear( summary.p95, 0.095, Tolerance ) );
+	ELR_CHECK( IsNear( summary.p99, 0.099, Tolerance ) );
+}
+
+ELR_TEST( OnlyKeepsTheLastWindow )
+{
+	FrameTimeStatistics statistics;
+	for ( uint32_t i = 0; i < FrameTimeStatistics::MaxSamples; i++ )
+		statistics.AddSample( 1.0 );
+	for ( uint32_t i = 0; i < FrameTimeStatistics::MaxSamples; i++ )
+		statistics.AddSample( 0.01 );
+
+	FrameTimeSummary summary;
+	ELR_CHECK( statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.numFrames == FrameTimeStatistics::MaxSamples );
+	ELR_CHECK( summary.totalFrames == 2 * FrameTimeStatistics::MaxSamples );
+	ELR_CHECK( IsNear( summary.max, 0.01, Tolerance ) );
+}
+
+ELR_TEST( Stutters )
+{
+	FrameTimeStatistics statistics;
+	for ( int i = 0; i < 50; i++ )
+		statistics.AddSample( 0.016 );
+	statistics.AddSample( 0.100 );
+	for ( int i = 0; i < 50; i++ )
+		statistics.AddSample( 0.016 );
+
+	FrameTimeSummary summary;
+	ELR_CHECK( statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.stutterCount == 1 );
+	ELR_CHECK( summary.totalStutterCount == 1 );
+
+	// the same frame is fine with a looser threshold
+	statistics.Reset();
+	statistics.SetStutterThreshold( 10.0 );
+	for ( int i = 0; i < 50; i++ )
+		statistics.AddSample( 0.016 );
+	statistics.AddSample( 0.100 );
+
+	ELR_CHECK( statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.stutterCount == 0 );
+	ELR_CHECK( summary.totalStutterCount == 0 );
+}
+
+ELR_TEST( Reset )
+{
+	FrameTimeStatistics statistics;
+	statistics.AddSample( 0.016 );
+	statistics.Reset();
+
+	FrameTimeSummary summary;
+	ELR_CHECK( !statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.totalFrames == 0 );
+}
+
+ELR_TEST( ResetTakesEffectWithTheNextSample )
+{
+	FrameTimeStatistics statistics;
+	statistics.AddSample( 1.0 );
+	statistics.AddSample( 1.0 );
+	statistics.Reset();
+
+	FrameTimeSummary summary;
+	statistics.AddSample( 0.5 );
+	ELR_CHECK( statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.totalFrames == 1 );
+	ELR_CHECK( IsNear( summary.max, 0.5, Tolerance ) );
+}
+
+ELR_TEST( ResetFromAnotherThread )
+{
+	FrameTimeStatistics statistics;
+	std::atomic<bool> done{ false };
+
+	// like a monitoring thread next to the one presenting
+	std::thread monitor( [&]()
+		{
+			FrameTimeSummary summary;
+			while ( !done.load() )
+			{
+				statistics.GetSummary( summary );
+				statistics.Reset();
+				std::this_thread::yield();
+			}
+		} );
+
+	for ( int i = 0; i < 100000; i++ )
+		statistics.AddSample( (i % 100 == 0) ? 0.1 : 0.016 );
+	done.store( true );
+	monitor.join();
+
+	// whatever was left since the last reset
+	statistics.AddSample( 0.016 );
+	FrameTimeSummary summary;
+	ELR_CHECK( statistics.GetSummary( summary ) );
+	ELR_CHECK( summary.numFrames <= FrameTimeStatistics::MaxSamples );
+	ELR_CHECK( summary.totalFrames >= summary.numFrames );
+	ELR_CHECK( summary.max <= 0.1 + Tolerance );
+}
+
+ELR_TEST_MAIN()
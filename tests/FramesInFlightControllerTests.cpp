@@ -0,0 +1,185 @@
+#include "elegy-rhi/FramesInFlightController.hpp"
+
+#include "Test.hpp"
+
+using namespace nvrhi::app;
+
+namespace
+{
+	constexpr double FrameTime = 0.016;
+
+	// the CPU never waits and the GPU is idle by the time each frame comes in
+	void FeedHeadroomWindow( FramesInFlightController& controller )
+	{
+		for ( uint32_t i = 0; i < FramesInFlightController::WindowFrames; i++ )
+			controller.AddFrame( FrameTime, 0.0, 1 );
+	}
+
+	// the CPU waits for half of every frame and the GPU always has the previous frame to work on
+	void FeedGpuBoundWindow( FramesInFlightController& controller )
+	{
+		for ( uint32_t i = 0; i < FramesInFlightController::WindowFrames; i++ )
+			controller.AddFrame( FrameTime, FrameTime * 0.5, 2 );
+	}
+
+	// CPU and GPU take turns being the slow one
+	void FeedMixedWindow( FramesInFlightController& controller )
+	{
+		for ( uint32_t i = 0; i < FramesInFlightController::WindowFrames; i++ )
+		{
+			if ( i % 2 == 0 )
+				controller.AddFrame( FrameTime, FrameTime * 0.5, 2 );
+			else
+				controller.AddFrame( FrameTime, 0.0, 1 );
+		}
+	}
+}
+
+ELR_TEST( StartsAtTheMaximum )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 3 );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+}
+
+ELR_TEST( ClampsTheBounds )
+{
+	FramesInFlightController controller;
+
+	controller.Reset( 0, 0 );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+
+	// a minimum above the maximum is the maximum
+	controller.Reset( 5, 3 );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+}
+
+ELR_TEST( OnlyDecidesOncePerWindow )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 3 );
+
+	for ( uint32_t i = 0; i + 1 < FramesInFlightController::WindowFrames; i++ )
+		controller.AddFrame( FrameTime, 0.0, 1 );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+
+	controller.AddFrame( FrameTime, 0.0, 1 );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+}
+
+ELR_TEST( GpuHeadroomGoesDownToTheMinimum )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 3 );
+
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+}
+
+ELR_TEST( SteadyGpuBoundGoesDown )
+{
+	FramesInFlightController controller;
+	controller.Reset( 2, 3 );
+
+	FeedGpuBoundWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedGpuBoundWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+}
+
+ELR_TEST( GpuBoundWithSpikesStays )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 3 );
+
+	// one frame far over the average is what the queue is there to absorb
+	for ( uint32_t i = 0; i < FramesInFlightController::WindowFrames; i++ )
+	{
+		const double frameTime = (i == 30) ? FrameTime * 4.0 : FrameTime;
+		controller.AddFrame( frameTime, frameTime * 0.5, 2 );
+	}
+
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+}
+
+ELR_TEST( MixedGoesUpToTheMaximum )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 3 );
+	FeedHeadroomWindow( controller );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+
+	FeedMixedWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedMixedWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+	FeedMixedWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+}
+
+ELR_TEST( NoiseIsNotGpuBound )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 2 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+
+	// waits of a few percent of the frame with a starved GPU are scheduling noise, not a reason to go up
+	for ( uint32_t i = 0; i < FramesInFlightController::WindowFrames; i++ )
+		controller.AddFrame( FrameTime, FrameTime * 0.01, 1 );
+
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+}
+
+ELR_TEST( RaisingBacksOffTheNextStepDown )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 2 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+
+	// the first raise holds the depth for one window
+	FeedMixedWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+
+	// the next one for two
+	FeedMixedWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedHeadroomWindow( controller );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 2 );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+}
+
+ELR_TEST( ResetStartsOver )
+{
+	FramesInFlightController controller;
+	controller.Reset( 1, 3 );
+	FeedHeadroomWindow( controller );
+	FeedHeadroomWindow( controller );
+	ELR_CHECK( controller.GetFramesInFlight() == 1 );
+
+	controller.Reset( 1, 3 );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+
+	// and forgets the frames of the window it was in
+	for ( uint32_t i = 0; i + 1 < FramesInFlightController::WindowFrames; i++ )
+		controller.AddFrame( FrameTime, 0.0, 1 );
+	controller.Reset( 1, 3 );
+	controller.AddFrame( FrameTime, 0.0, 1 );
+	ELR_CHECK( controller.GetFramesInFlight() == 3 );
+}
+
+ELR_TEST_MAIN()
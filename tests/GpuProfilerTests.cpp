@@ -0,0 +1,141 @@
+// Runs on headless Vulkan, a software ICD like lavapipe is enough. Skipped when no Vulkan device can be created
+
+#include "elegy-rhi/DeviceManager.hpp"
+#include "elegy-rhi/GpuProfiler.hpp"
+
+#include "Test.hpp"
+
+#include <memory>
+#include <string>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	std::unique_ptr<DeviceManager> CreateHeadlessVulkanDevice()
+	{
+		DeviceCreationParameters params;
+		params.headless = true;
+		params.backBufferWidth = 64;
+		params.backBufferHeight = 64;
+
+		std::unique_ptr<DeviceManager> deviceManager( DeviceManager::Create( nvrhi::GraphicsAPI::VULKAN ) );
+		if ( !deviceManager || !deviceManager->CreateWindowDeviceAndSwapChain( params ) )
+			return nullptr;
+
+		return deviceManager;
+	}
+
+	// Records one frame with an outer zone around two nested ones, and waits for the GPU to finish it
+	void RecordFrame( nvrhi::IDevice* device, nvrhi::ICommandList* commandList, GpuProfiler& profiler )
+	{
+		commandList->open();
+		{
+			const GpuProfilerZone outer( &profiler, commandList, "Outer" );
+			{
+				const GpuProfilerZone first( &profiler, commandList, "First" );
+			}
+			{
+				const GpuProfilerZone second( &profiler, commandList, "Second" );
+			}
+		}
+		commandList->close();
+
+		device->executeCommandList( commandList );
+		device->waitForIdle();
+	}
+
+	constexpr uint32_t ZonesPerFrame = 3;
+}
+
+ELR_TEST( ResolvesNestedZones )
+{
+	std::unique_ptr<DeviceManager> deviceManager = CreateHeadlessVulkanDevice();
+	if ( !deviceManager )
+		ELR_SKIP( "no Vulkan device" );
+
+	nvrhi::IDevice* device = deviceManager->GetDevice();
+	nvrhi::CommandListHandle commandList = device->createCommandList();
+	GpuProfiler profiler( device, 2 );
+
+	RecordFrame( device, commandList, profiler );
+
+	// nothing is resolved before the frame is known to be done
+	profiler.EndFrame( 5, 4 );
+	ELR_CHECK( profiler.GetLatestTimings().frameValue == 0 );
+
+	profiler.EndFrame( 6, 5 );
+	const GpuFrameTimings& timings = profiler.GetLatestTimings();
+	ELR_CHECK( timings.frameValue == 5 );
+	ELR_CHECK( timings.zones.size() == ZonesPerFrame );
+	if ( timings.zones.size() == ZonesPerFrame )
+	{
+		ELR_CHECK( std::string( timings.zones[0].name ) == "Outer" );
+		ELR_CHECK( timings.zones[0].depth == 0 );
+		ELR_CHECK( timings.zones[0].parent == GpuProfiler::NoParent );
+
+		ELR_CHECK( std::string( timings.zones[1].name ) == "First" );
+		ELR_CHECK( std::string( timings.zones[2].name ) == "Second" );
+		for ( uint32_t i = 1; i < ZonesPerFrame; i++ )
+		{
+			ELR_CHECK( timings.zones[i].depth == 1 );
+			ELR_CHECK( timings.zones[i].parent == 0 );
+		}
+
+		for ( const GpuZoneTiming& zone : timings.zones )
+		{
+			ELR_CHECK( zone.milliseconds >= 0.0f );
+			// a second is plenty for an empty zone, anything more means the timestamps are garbage
+			ELR_CHECK( zone.milliseconds < 1000.0f );
+		}
+	}
+
+	ELR_CHECK( profiler.GetDroppedFrameCount() == 0 );
+
+	device->waitForIdle();
+	deviceManager->Shutdown();
+}
+
+ELR_TEST( DropsFramesTheGpuIsLateFor )
+{
+	std::unique_ptr<DeviceManager> deviceManager = CreateHeadlessVulkanDevice();
+	if ( !deviceManager )
+		ELR_SKIP( "no Vulkan device" );
+
+	nvrhi::IDevice* device = deviceManager->GetDevice();
+	nvrhi::CommandListHandle commandList = device->createCommandList();
+
+	constexpr uint32_t MaxFramesInFlight = 2;
+	GpuProfiler profiler( device, MaxFramesInFlight );
+
+	// The GPU is actually done with every frame, but the completed frame value says otherwise,
+	// so each frame is still pending when its slot comes around again
+	constexpr uint64_t NumFrames = 100;
+	for ( uint64_t frameValue = 1; frameValue <= NumFrames; frameValue++ )
+	{
+		RecordFrame( device, commandList, profiler );
+		profiler.EndFrame( frameValue, 1 );
+	}
+
+	// frame 1 resolves, the ones still in their slots at the end are neither resolved nor dropped
+	const uint64_t numSlots = MaxFramesInFlight + 1;
+	ELR_CHECK( profiler.GetLatestTimings().frameValue == 1 );
+	ELR_CHECK( profiler.GetDroppedFrameCount() == NumFrames - 1 - (numSlots - 1) );
+
+	// The queries of dropped frames are reused once the GPU is done with them instead of piling up:
+	// one set per slot, plus the set of the frame being dropped
+	ELR_CHECK( profiler.GetQueryCount() <= (numSlots + 1) * ZonesPerFrame );
+
+	// and once frames complete in time, resolving picks up again
+	for ( uint64_t frameValue = NumFrames + 1; frameValue <= NumFrames + numSlots; frameValue++ )
+	{
+		RecordFrame( device, commandList, profiler );
+		profiler.EndFrame( frameValue, frameValue );
+	}
+	ELR_CHECK( profiler.GetLatestTimings().frameValue == NumFrames + numSlots );
+
+	device->waitForIdle();
+	deviceManager->Shutdown();
+}
+
+ELR_TEST_MAIN()
@@ -0,0 +1,370 @@
+#include "elegy-rhi/Logger.hpp"
+
+#include "Test.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	struct Message
+	{
+		nvrhi::MessageSeverity severity;
+		std::string text;
+	};
+
+	// Keeps everything it is given. The logging thread writes while a test thread may read,
+	// so the list is behind a mutex that is never held while logging
+	class CapturingCallback : public nvrhi::IMessageCallback
+	{
+	public:
+		void message( nvrhi::MessageSeverity severity, const char* text ) override
+		{
+			onMessage( severity, text );
+
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			m_Messages.push_back( { severity, text } );
+		}
+
+		std::vector<Message> GetMessages()
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			return m_Messages;
+		}
+
+		std::string GetLastText()
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			return m_Messages.empty() ? std::string() : m_Messages.back().text;
+		}
+
+	protected:
+		virtual void onMessage( nvrhi::MessageSeverity, const char* ) { }
+
+	private:
+		std::mutex m_Mutex;
+		std::vector<Message> m_Messages;
+	};
+
+	// Holds the logging thread inside the callback on the first message until released,
+	// so the queue behind it can be filled up
+	class BlockingCallback : public CapturingCallback
+	{
+	public:
+		void WaitUntilBlocked()
+		{
+			while ( !m_Blocked.load() )
+				std::this_thread::yield();
+		}
+
+		void Release() { m_Released.store( true ); }
+
+	protected:
+		void onMessage( nvrhi::MessageSeverity, const char* ) override
+		{
+			if ( m_Blocked.exchange( true ) )
+				return;
+
+			while ( !m_Released.load() )
+				std::this_thread::yield();
+
+			onReleased();
+		}
+
+		virtual void onReleased() { }
+
+	private:
+		std::atomic<bool> m_Blocked{ false };
+		std::atomic<bool> m_Released{ false };
+	};
+
+	std::string Format( Logger& logger, CapturingCallback& callback )
+	{
+		logger.Flush();
+		return callback.GetLastText();
+	}
+
+	// Fills the queue behind the blocked first message, returns how many messages were logged
+	uint32_t FillQueue( Logger& logger, BlockingCallback& callback )
+	{
+		logger.Log( &callback, nvrhi::MessageSeverity::Info, "first" );
+		callback.WaitUntilBlocked();
+
+		const uint32_t numMessages = Logger::QueueSize + 88;
+		for ( uint32_t i = 0; i < numMessages; i++ )
+			logger.Log( &callback, nvrhi::MessageSeverity::Info, "info %u", i );
+
+		return numMessages;
+	}
+}
+
+ELR_TEST( FormatsIntegers )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%d %u %i", -5, 7u, -(int64_t( 1 ) << 40) );
+	ELR_CHECK( Format( logger, callback ) == "-5 7 -1099511627776" );
+
+	// length modifiers are ignored
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%zu %lld %hhu", size_t( 42 ), 43ll, uint8_t( 44 ) );
+	ELR_CHECK( Format( logger, callback ) == "42 43 44" );
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%x %08X %o", 255u, 0xbeefu, 8u );
+	ELR_CHECK( Format( logger, callback ) == "ff 0000BEEF 10" );
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%d %d", true, nvrhi::MessageSeverity::Error );
+	ELR_CHECK( Format( logger, callback ) == "1 2" );
+}
+
+ELR_TEST( FormatsFloats )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%08.3f %.1f %g", 3.14159, 2.5f, 0.5 );
+	ELR_CHECK( Format( logger, callback ) == "0003.142 2.5 0.5" );
+}
+
+ELR_TEST( FormatsStrings )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	const std::string string = "std";
+	const std::string_view view = "view";
+	const char* null = nullptr;
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%s %s %s %s", "literal", string, view, null );
+	ELR_CHECK( Format( logger, callback ) == "literal std view (null)" );
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "[%5s][%-5s][%.2s]", "ab", "ab", "abcdef" );
+	ELR_CHECK( Format( logger, callback ) == "[   ab][ab   ][ab]" );
+}
+
+ELR_TEST( CopiesStrings )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	// the argument is gone before the message is formatted
+	{
+		std::string temporary = "temporary";
+		logger.Log( &callback, nvrhi::MessageSeverity::Info, "%s", temporary );
+		temporary.assign( temporary.size(), 'x' );
+	}
+	ELR_CHECK( Format( logger, callback ) == "temporary" );
+
+	// too long for the inline storage
+	const std::string first( Logger::InlineStringBytes - 10, 'a' );
+	const std::string second( 1000, 'b' );
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%s|%s", first, second );
+	ELR_CHECK( Format( logger, callback ) == first + "|" + second );
+}
+
+ELR_TEST( SurvivesBadFormats )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%d %d", 1 );
+	ELR_CHECK( Format( logger, callback ) == "1 <missing>" );
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "%d", "string" );
+	ELR_CHECK( Format( logger, callback ) == "<bad format>" );
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "100%% %" );
+	ELR_CHECK( Format( logger, callback ) == "100% " );
+}
+
+ELR_TEST( KeepsOrderAndSeverity )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	for ( uint32_t i = 0; i < Logger::QueueSize * 3; i++ )
+		logger.Log( &callback, (i % 2) ? nvrhi::MessageSeverity::Warning : nvrhi::MessageSeverity::Info, "%u", i );
+	logger.Flush();
+
+	// nothing is dropped when the logging thread keeps up, and it may not here, so only check what arrived
+	const std::vector<Message> messages = callback.GetMessages();
+	ELR_CHECK( messages.size() + logger.GetDroppedCount() >= Logger::QueueSize * 3 );
+
+	int64_t previous = -1;
+	for ( const Message& message : messages )
+	{
+		if ( message.text.find( "dropped" ) != std::string::npos )
+			continue;
+
+		const int64_t value = std::stoll( message.text );
+		ELR_CHECK( value > previous );
+		ELR_CHECK( message.severity == ((value % 2) ? nvrhi::MessageSeverity::Warning : nvrhi::MessageSeverity::Info) );
+		previous = value;
+	}
+}
+
+ELR_TEST( ErrorsAreDeliveredBeforeLogReturns )
+{
+	Logger logger;
+	CapturingCallback callback;
+
+	logger.Log( &callback, nvrhi::MessageSeverity::Error, "error %d", 1 );
+	ELR_CHECK( callback.GetLastText() == "error 1" );
+}
+
+ELR_TEST( FullQueueDropsAndReports )
+{
+	Logger logger;
+	BlockingCallback callback;
+
+	// the blocked first message still holds its slot
+	const uint32_t numMessages = FillQueue( logger, callback );
+	const uint64_t expectedDropped = numMessages - (Logger::QueueSize - 1);
+	ELR_CHECK( logger.GetDroppedCount() == expectedDropped );
+
+	callback.Release();
+	logger.Flush();
+	// the report follows the batch it was noticed in, so it is out once the next message is
+	logger.Log( &callback, nvrhi::MessageSeverity::Info, "last" );
+	logger.Flush();
+
+	const std::vector<Message> messages = callback.GetMessages();
+	ELR_CHECK( messages.size() == Logger::QueueSize + 2 );
+	ELR_CHECK( messages.front().text == "first" );
+	ELR_CHECK( messages[Logger::QueueSize - 1].text == "info " + std::to_string( Logger::QueueSize - 2 ) );
+	ELR_CHECK( messages.back().text == "last" );
+
+	const Message& report = messages[Logger::QueueSize];
+	ELR_CHECK( report.severity == nvrhi::MessageSeverity::Warning );
+	ELR_CHECK( report.text == std::to_string( expectedDropped ) + " log messages were dropped because the queue was full" );
+}
+
+ELR_TEST( FullQueueWaitsForErrors )
+{
+	Logger logger;
+	BlockingCallback callback;
+	FillQueue( logger, callback );
+	const uint64_t dropped = logger.GetDroppedCount();
+
+	std::atomic<bool> logged{ false };
+	std::thread thread( [&]()
+		{
+			logger.Log( &callback, nvrhi::MessageSeverity::Error, "error" );
+			logged.store( true );
+		} );
+
+	// nowhere to go until the logging thread moves on
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+	ELR_CHECK( !logged.load() );
+
+	callback.Release();
+	thread.join();
+
+	ELR_CHECK( logger.GetDroppedCount() == dropped );
+
+	// delivered in order behind everything that made it into the queue
+	const std::vector<Message> messages = callback.GetMessages();
+	uint32_t numErrors = 0;
+	for ( size_t i = 0; i < messages.size(); i++ )
+	{
+		if ( messages[i].severity != nvrhi::MessageSeverity::Error )
+			continue;
+
+		numErrors++;
+		ELR_CHECK( messages[i].text == "error" );
+		ELR_CHECK( i >= Logger::QueueSize );
+	}
+	ELR_CHECK( numErrors == 1 );
+}
+
+ELR_TEST( FullQueueErrorFromTheCallback )
+{
+	// Logs an error from inside the callback while the queue is full, which can only be delivered inline
+	class ReentrantCallback : public BlockingCallback
+	{
+	public:
+		Logger* logger = nullptr;
+
+	protected:
+		void onReleased() override
+		{
+			logger->Log( this, nvrhi::MessageSeverity::Error, "from the callback" );
+		}
+	};
+
+	Logger logger;
+	ReentrantCallback callback;
+	callback.logger = &logger;
+	FillQueue( logger, callback );
+
+	callback.Release();
+	logger.Flush();
+
+	// the inline error lands before the message whose callback logged it has been recorded
+	const std::vector<Message> messages = callback.GetMessages();
+	ELR_CHECK( messages.size() >= 2 );
+	ELR_CHECK( messages[0].text == "from the callback" );
+	ELR_CHECK( messages[0].severity == nvrhi::MessageSeverity::Error );
+	ELR_CHECK( messages[1].text == "first" );
+}
+
+ELR_TEST( CallbackRunsOnOneThreadAtATime )
+{
+	class ExclusiveCallback : public nvrhi::IMessageCallback
+	{
+	public:
+		std::atomic<uint32_t> inside{ 0 };
+		std::atomic<bool> overlapped{ false };
+		std::atomic<uint32_t> numErrors{ 0 };
+
+		void message( nvrhi::MessageSeverity severity, const char* ) override
+		{
+			if ( inside.fetch_add( 1 ) != 0 )
+				overlapped.store( true );
+
+			if ( severity == nvrhi::MessageSeverity::Error )
+				numErrors++;
+			std::this_thread::yield();
+
+			inside.fetch_sub( 1 );
+		}
+	};
+
+	Logger logger;
+	ExclusiveCallback callback;
+
+	constexpr uint32_t NumThreads = 4;
+	constexpr uint32_t NumErrors = 60;
+	std::vector<std::thread> threads;
+	for ( uint32_t t = 0; t < NumThreads; t++ )
+	{
+		threads.emplace_back( [&]()
+			{
+				for ( uint32_t i = 0; i < NumErrors * 20; i++ )
+				{
+					const bool error = (i % 20) == 0;
+					logger.Log( &callback, error ? nvrhi::MessageSeverity::Error : nvrhi::MessageSeverity::Info, "%u", i );
+				}
+			} );
+	}
+	for ( std::thread& thread : threads )
+		thread.join();
+	logger.Flush();
+
+	ELR_CHECK( !callback.overlapped.load() );
+	ELR_CHECK( callback.numErrors.load() == NumThreads * NumErrors );
+}
+
+ELR_TEST( IdleLogger )
+{
+	Logger logger;
+	logger.Flush();
+	logger.Log( nullptr, nvrhi::MessageSeverity::Error, "nowhere" );
+	logger.Flush();
+	ELR_CHECK( logger.GetDroppedCount() == 0 );
+}
+
+ELR_TEST_MAIN()
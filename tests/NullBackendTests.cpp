@@ -0,0 +1,174 @@
+#include "elegy-rhi/DeviceManager.hpp"
+
+#include "Test.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace nvrhi::app;
+using nvrhi::app::test::IsNear;
+
+namespace
+{
+	std::unique_ptr<DeviceManager> CreateNullDevice( DeviceCreationParameters& params )
+	{
+		params.headless = true;
+		params.backBufferWidth = 64;
+		params.backBufferHeight = 64;
+
+		std::unique_ptr<DeviceManager> deviceManager( DeviceManager::CreateNull() );
+		if ( !deviceManager->CreateWindowDeviceAndSwapChain( params ) )
+			return nullptr;
+
+		return deviceManager;
+	}
+
+	void RunFrame( DeviceManager& deviceManager, std::chrono::microseconds cpuFrameTime = {} )
+	{
+		deviceManager.BeginFrame();
+		std::this_thread::sleep_for( cpuFrameTime );
+		deviceManager.Present();
+	}
+}
+
+ELR_TEST( CountsFrames )
+{
+	DeviceCreationParameters params;
+	std::unique_ptr<DeviceManager> deviceManager = CreateNullDevice( params );
+	ELR_CHECK( deviceManager != nullptr );
+	if ( !deviceManager )
+		return;
+
+	ELR_CHECK( deviceManager->GetGraphicsAPI() == nvrhi::GraphicsAPI::VULKAN );
+	ELR_CHECK( deviceManager->GetCurrentFrameValue() == 0 );
+	for ( int i = 0; i < 10; i++ )
+		RunFrame( *deviceManager );
+	ELR_CHECK( deviceManager->GetCurrentFrameValue() == 10 );
+	ELR_CHECK( deviceManager->GetFrameIndex() == 10 );
+
+	// with nothing in flight anymore
+	deviceManager->Shutdown();
+	ELR_CHECK( deviceManager->GetCompletedFrameValue() == 10 );
+}
+
+ELR_TEST( SimulatesGpuTime )
+{
+	DeviceCreationParameters params;
+	params.maxFramesInFlight = 2;
+	params.nullGpuFrameTime = 0.05;
+	std::unique_ptr<DeviceManager> deviceManager = CreateNullDevice( params );
+	ELR_CHECK( deviceManager != nullptr );
+	if ( !deviceManager )
+		return;
+
+	// the first frame doesn't have to wait for anything, and the GPU is far from done with it
+	RunFrame( *deviceManager );
+	ELR_CHECK( deviceManager->GetCurrentFrameValue() == 1 );
+	ELR_CHECK( deviceManager->GetCompletedFrameValue() == 0 );
+
+	deviceManager->Shutdown();
+	ELR_CHECK( deviceManager->GetCompletedFrameValue() == 1 );
+}
+
+ELR_TEST( FrameWaitIsTimed )
+{
+	class RecordingCallback : public IBlockingTimeCallback
+	{
+	public:
+		std::vector<FrameBlockingTimes> frames;
+
+		void OnFrameBlockingTimes( const FrameBlockingTimes& times ) override
+		{
+			frames.push_back( times );
+		}
+	};
+
+	RecordingCallback callback;
+	DeviceCreationParameters params;
+	params.maxFramesInFlight = 2;
+	params.nullGpuFrameTime = 0.002;
+	params.blockingTimeCallback = &callback;
+	std::unique_ptr<DeviceManager> deviceManager = CreateNullDevice( params );
+	ELR_CHECK( deviceManager != nullptr );
+	if ( !deviceManager )
+		return;
+
+	constexpr uint32_t NumFrames = 20;
+	for ( uint32_t i = 0; i < NumFrames; i++ )
+	{
+		RunFrame( *deviceManager );
+		ELR_CHECK( deviceManager->GetCurrentFrameValue() - deviceManager->GetCompletedFrameValue() <= 2 );
+	}
+
+	// the CPU does nothing, so it spends most of its time waiting for the GPU
+	const BlockingTimeHistogram& frameWait = deviceManager->GetBlockingTimeHistogram( BlockingCalls::FrameWait );
+	ELR_CHECK( frameWait.GetTotalCount() > 0 );
+	ELR_CHECK( frameWait.GetTotalSeconds() > 0.0 );
+	ELR_CHECK( deviceManager->GetBlockingTimeHistogram( BlockingCalls::AcquireImage ).GetTotalCount() == 0 );
+
+	// one report per frame, adding up to the histogram
+	ELR_CHECK( callback.frames.size() == NumFrames );
+	double reportedWait = 0.0;
+	for ( const FrameBlockingTimes& times : callback.frames )
+		reportedWait += times.seconds[BlockingCalls::FrameWait];
+	ELR_CHECK( IsNear( reportedWait, frameWait.GetTotalSeconds(), 1e-6 ) );
+
+	deviceManager->ResetBlockingTimeHistograms();
+	ELR_CHECK( frameWait.GetTotalCount() == 0 );
+
+	deviceManager->Shutdown();
+}
+
+ELR_TEST( AdaptiveFramesInFlightFollowsTheGpu )
+{
+	DeviceCreationParameters params;
+	params.maxFramesInFlight = 3;
+	params.minFramesInFlight = 1;
+	std::unique_ptr<DeviceManager> deviceManager = CreateNullDevice( params );
+	ELR_CHECK( deviceManager != nullptr );
+	if ( !deviceManager )
+		return;
+
+	ELR_CHECK( deviceManager->GetFramesInFlight() == 3 );
+
+	// An idle GPU never needs more than one frame. Frames of a few microseconds would make the
+	// overhead of the frame wait itself look like waiting for the GPU, so the CPU takes its time
+	deviceManager->SetAdaptiveFramesInFlight( true );
+	ELR_CHECK( deviceManager->GetFramesInFlight() == 3 );
+	for ( uint32_t i = 0; i < FramesInFlightController::WindowFrames * 3; i++ )
+		RunFrame( *deviceManager, std::chrono::milliseconds( 1 ) );
+	ELR_CHECK( deviceManager->GetFramesInFlight() == 1 );
+
+	deviceManager->SetAdaptiveFramesInFlight( false );
+	ELR_CHECK( deviceManager->GetFramesInFlight() == 3 );
+
+	deviceManager->Shutdown();
+}
+
+ELR_TEST( ResizeKeepsGoing )
+{
+	DeviceCreationParameters params;
+	params.swapChainBufferCount = 3;
+	std::unique_ptr<DeviceManager> deviceManager = CreateNullDevice( params );
+	ELR_CHECK( deviceManager != nullptr );
+	if ( !deviceManager )
+		return;
+
+	RunFrame( *deviceManager );
+	deviceManager->UpdateWindowSize( 128, 32 );
+	RunFrame( *deviceManager );
+
+	int width = 0;
+	int height = 0;
+	deviceManager->GetWindowDimensions( width, height );
+	ELR_CHECK( width == 128 && height == 32 );
+	ELR_CHECK( deviceManager->GetBackBufferCount() == 3 );
+	ELR_CHECK( deviceManager->GetCurrentBackBufferIndex() < 3 );
+	ELR_CHECK( deviceManager->GetCurrentFrameValue() == 2 );
+
+	deviceManager->Shutdown();
+}
+
+ELR_TEST_MAIN()
@@ -0,0 +1,102 @@
+// Just enough of a test harness for the unit tests: ELR_TEST defines a test, ELR_CHECK reports a failed
+// check and carries on, ELR_SKIP leaves a test that can't run here (no GPU, say), and every test executable
+// ends with ELR_TEST_MAIN. Run them all with ctest
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace nvrhi::app::test
+{
+	struct TestCase
+	{
+		const char* name;
+		void ( *function )();
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	// ctest reports an executable that exits with this as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+	constexpr int SkipReturnCode = 77;
+
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline int& GetSkipCount()
+	{
+		static int skips = 0;
+		return skips;
+	}
+
+	struct TestRegistrar
+	{
+		TestRegistrar( const char* name, void ( *function )() )
+		{
+			GetTests().push_back( { name, function } );
+		}
+	};
+
+	inline void ReportFailure( const char* file, int line, const char* expression )
+	{
+		fprintf( stderr, "%s(%d): check failed: %s\n", file, line, expression );
+		GetFailureCount()++;
+	}
+
+	inline void ReportSkip( const char* reason )
+	{
+		printf( "       skipped: %s\n", reason );
+		GetSkipCount()++;
+	}
+
+	inline bool IsNear( double a, double b, double tolerance = 1e-9 )
+	{
+		return std::fabs( a - b ) <= tolerance;
+	}
+
+	inline int RunTests()
+	{
+		for ( const TestCase& test : GetTests() )
+		{
+			const int failuresBefore = GetFailureCount();
+			const int skipsBefore = GetSkipCount();
+			test.function();
+
+			const char* result = "[ ok ]";
+			if ( GetFailureCount() != failuresBefore )
+				result = "[FAIL]";
+			else if ( GetSkipCount() != skipsBefore )
+				result = "[skip]";
+			printf( "%s %s\n", result, test.name );
+		}
+
+		if ( GetFailureCount() != 0 )
+			return 1;
+
+		// some tests skipped is still a pass, all of them is a skip
+		return (GetSkipCount() == int( GetTests().size() )) ? SkipReturnCode : 0;
+	}
+}
+
+#define ELR_TEST( name ) \
+	static void name(); \
+	static const ::nvrhi::app::test::TestRegistrar name##Registrar( #name, name ); \
+	static void name()
+
+#define ELR_CHECK( expression ) \
+	do { if ( !(expression) ) ::nvrhi::app::test::ReportFailure( __FILE__, __LINE__, #expression ); } while ( false )
+
+// Leaves the test, checks made before still count
+#define ELR_SKIP( reason ) \
+	do { ::nvrhi::app::test::ReportSkip( reason ); return; } while ( false )
+
+#define ELR_TEST_MAIN() \
+	int main() { return ::nvrhi::app::test::RunTests(); }
@@ -0,0 +1,65 @@
+#include "elegy-rhi/Trace.hpp"
+
+#include "Test.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace nvrhi::app;
+
+namespace
+{
+	std::string GetTestPath( const char* name )
+	{
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	std::string ReadFile( const std::string& path )
+	{
+		std::ifstream file( path, std::ios::binary );
+		std::stringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+}
+
+ELR_TEST( ExportsWhatWasRecorded )
+{
+	const std::string jsonPath = GetTestPath( "elegy-rhi-trace.json" );
+	const std::string perfettoPath = GetTestPath( "elegy-rhi-trace.perfetto-trace" );
+
+	Trace::Clear();
+	Trace::SetThreadName( "TestThread" );
+	{
+		ELR_TRACE_SCOPE( "TestScope" );
+	}
+	Trace::Record( "TestRecord", Trace::Now(), Trace::Now() + 1000 );
+
+	if ( !Trace::IsEnabled() )
+	{
+		ELR_CHECK( !Trace::WriteChromeJson( jsonPath ) );
+		ELR_CHECK( !Trace::WritePerfetto( perfettoPath ) );
+		return;
+	}
+
+	ELR_CHECK( Trace::WriteChromeJson( jsonPath ) );
+	const std::string json = ReadFile( jsonPath );
+	ELR_CHECK( json.find( "\"TestScope\"" ) != std::string::npos );
+	ELR_CHECK( json.find( "\"TestRecord\"" ) != std::string::npos );
+	ELR_CHECK( json.find( "\"TestThread\"" ) != std::string::npos );
+
+	ELR_CHECK( Trace::WritePerfetto( perfettoPath ) );
+	const std::string perfetto = ReadFile( perfettoPath );
+	ELR_CHECK( perfetto.find( "TestRecord" ) != std::string::npos );
+
+	// nothing left after clearing
+	Trace::Clear();
+	ELR_CHECK( Trace::WriteChromeJson( jsonPath ) );
+	ELR_CHECK( ReadFile( jsonPath ).find( "\"TestRecord\"" ) == std::string::npos );
+
+	std::filesystem::remove( jsonPath );
+	std::filesystem::remove( perfettoPath );
+}
+
+ELR_TEST_MAIN()